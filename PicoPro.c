@@ -35,6 +35,14 @@
 #include <string.h>
 
 #include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "hardware/uart.h"
+#include "hardware/vreg.h"
+#include "hardware/regs/addressmap.h"
+#include "hardware/regs/m0plus.h"
+#include "hardware/structs/scb.h"
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
 #include "pico/bootrom.h"
@@ -43,75 +51,23 @@
 #include "tusb.h"
 #include "pico/time.h"
 
-
-typedef struct {
-  char key;
-  int byte;
-  int shift;
-} switchButtonMaps;
-
-typedef struct {
-  uint8_t modifier;
-  int byte;
-  int shift;
-} switchModifierMaps;
-
-typedef struct {
-  int byte;
-  int shift;
-} buttonLocation;
-
-buttonLocation findKeyMap(switchButtonMaps keyMap[], int size, char key) {
-  buttonLocation loc = { -1, -1 };
-  for (int i=0; i < size; i++) {
-    if (keyMap[i].key == key) {
-      loc.byte = keyMap[i].byte;
-      loc.shift = keyMap[i].shift;
-      break;
-    }
-  }
-  return loc;
-}
-
-buttonLocation findModifierMap(switchModifierMaps modifierMap[], int size, uint8_t modifier) {
-  buttonLocation loc = { -1, -1 };
-  for (int i=0; i < size; i++) {
-    if (modifierMap[i].modifier == modifier) {
-      loc.byte = modifierMap[i].byte;
-      loc.shift = modifierMap[i].shift;
-      break;
-    }
-  }
-  return loc;
-}
-
-// IN ORDER:
-// mapped character
-// byte of button input report (starting from 0, which is byte 3 in the final report).
-// bitshift count 
-switchButtonMaps keyMap[] = { \
-  {'y', 0, 0}, /* Y button         */ \
-  {'x', 0, 1}, /* X button         */ \
-  {' ', 0, 2}, /* B button         */ \
-  {'e', 0, 3}, /* A button         */ \
-  {'r', 0, 6}, /* R button         */ \
-  {'z', 0, 7}, /* ZR button        */ \
-  {'p', 1, 1}, /* Plus button      */ \
-  {'q', 2, 7}, /* ZL button        */ \
-  {'w', 3, 0}, /* Left stick up    */ \
-  {'s', 3, 1}, /* Left stick down  */ \
-  {'a', 3, 2}, /* Left stick left  */ \
-  {'d', 3, 3}, /* Left stick up    */ \
-};
-
-
-// IN ORDER:
-// mapped modifier
-// byte of button input report (starting from 0, which is byte 3 in the final report).
-// bitshift count 
-switchButtonMaps modifierMap[] = { \
-  {0x02, 2, 7}, /* ZL button         */ \
-};
+#include "hid_ring.h"
+#include "report_queue.h"
+#include "keymap.h"
+#include "kbd_layout.h"
+#include "mouse_layout.h"
+#include "input.h"
+#include "profile.h"
+#include "profile_upload.h"
+#include "boot_metrics.h"
+#include "switch_proto.h"
+#include "pro_report.h"
+#include "capture.h"
+#include "telemetry.h"
+#include "log_ring.h"
+#include "task_timing.h"
+#include "sched.h"
+#include "rate_profile.h"
 
 
 //--------------------------------------------------------------------+
@@ -119,10 +75,76 @@ switchButtonMaps modifierMap[] = { \
 //--------------------------------------------------------------------+
 
 
-void counter_task(void);
-void button_task(void);
+void hid_task(void);
+bool hid_pending(void);
+void report_frame_task(void);
+void report_refresh_task(void);
+bool report_refresh_pending(void);
+void cdc_task(void);
+bool cdc_pending(void);
+void capture_task(void);
+bool capture_pending(void);
+void log_task(void);
+bool log_task_pending(void);
+void core0_idle_init(void);
+void core0_idle(void);
+
+#define REPORT_PERIOD_US        RATE_REPORT_PERIOD_US
+#define BOOT_METRICS_PERIOD_US  100000
+
+// With 1 core0 sleeps until the next deadline on a hardware alarm; with 0
+// it keeps polling the clock.
+#ifndef PICOPRO_REPORT_ALARM
+#define PICOPRO_REPORT_ALARM 1
+#endif
+
+// core0 tasks (sched.h)
+enum {
+  CORE0_USB = 0,
+  CORE0_HID,
+  CORE0_FRAME,
+  CORE0_REFRESH,
+#if CFG_TUD_CDC
+  CORE0_CDC,
+#endif
+  CORE0_BOOT_METRICS,
+  CORE0_CAPTURE,
+  CORE0_LOG,
+  CORE0_TASK_COUNT
+};
+
+// HID comes before the frame of the same priority so a frame always
+// carries every report core1 has handed over
+static sched_task_t const core0_tasks[CORE0_TASK_COUNT] = {
+  [CORE0_USB]          = { tud_task,            tud_task_event_ready,   0,                      SCHED_PRIO_USB },
+  [CORE0_HID]          = { hid_task,            hid_pending,            0,                      SCHED_PRIO_REPORT },
+  [CORE0_FRAME]        = { report_frame_task,   NULL,                   REPORT_PERIOD_US,       SCHED_PRIO_REPORT },
+  [CORE0_REFRESH]      = { report_refresh_task, report_refresh_pending, 0,                      SCHED_PRIO_REPORT },
+#if CFG_TUD_CDC
+  [CORE0_CDC]          = { cdc_task,            cdc_pending,            0,                      SCHED_PRIO_TELEMETRY },
+#endif
+  [CORE0_BOOT_METRICS] = { boot_metrics_task,   NULL,                   BOOT_METRICS_PERIOD_US, SCHED_PRIO_TELEMETRY },
+  [CORE0_CAPTURE]      = { capture_task,        capture_pending,        0,                      SCHED_PRIO_LOG },
+  [CORE0_LOG]          = { log_task,            log_task_pending,       0,                      SCHED_PRIO_LOG },
+};
+
+_Static_assert(CORE0_TASK_COUNT <= SCHED_MAX_TASKS, "too many core0 tasks");
+
+#if PICOPRO_TASK_TIMING
+static const uint8_t core0_timing[CORE0_TASK_COUNT] = {
+  [CORE0_USB]          = TASK_TIMING_TUD_TASK,
+  [CORE0_HID]          = TASK_TIMING_HID_TASK,
+  [CORE0_FRAME]        = TASK_TIMING_REPORT_FRAME,
+  [CORE0_REFRESH]      = TASK_TIMING_REPORT_REFRESH,
+#if CFG_TUD_CDC
+  [CORE0_CDC]          = TASK_TIMING_CDC_TASK,
+#endif
+  [CORE0_BOOT_METRICS] = TASK_TIMING_BOOT_METRICS_TASK,
+  [CORE0_CAPTURE]      = TASK_TIMING_CAPTURE_TASK,
+  [CORE0_LOG]          = TASK_TIMING_LOG_TASK,
+};
+#endif
 
-static uint8_t const keycode2ascii[128][2] =  { HID_KEYCODE_TO_ASCII };
 uint32_t button_pressed = 0;
 bool rotate = false;
 
@@ -131,11 +153,13 @@ bool rotate = false;
 
 // core1: handle host events
 void core1_main() {
-  sleep_ms(10);
+  // lets core0 park this core while the profile sectors are reprogrammed
+  multicore_lockout_victim_init();
 
-  stdio_uart_init ();
   // Use tuh_configure() to pass pio configuration to the host stack
   // Note: tuh_configure() must be called before
+  // PIO-USB works out its clock dividers from clk_sys, so the default
+  // configuration fits every rate profile (rate_profile.h)
   pio_usb_configuration_t pio_cfg = PIO_USB_DEFAULT_CONFIG;
   tuh_configure(1, TUH_CFGID_RPI_PIO_USB_CONFIGURATION, &pio_cfg);
 
@@ -145,31 +169,62 @@ void core1_main() {
   // port1) on core1
   tuh_init(1);
 
+#if PICOPRO_TASK_TIMING
+  task_timing_init();
+#endif
+
   while (true) {
-    tuh_task(); // tinyusb host task
+    TASK_TIMED(TUH_TASK, tuh_task()); // tinyusb host task
+    TASK_TIMING_LOOP();
   }
 }
 
 // core0: handle device events
 int main(void) {
-  stdio_init_all();
+  boot_metrics_init();
   // default 125MHz is not appropreate. Sysclock should be multiple of 12MHz.
-  set_sys_clock_khz(120000, true);
+#if RATE_SYS_CLOCK_KHZ > 133000
+  // past the rated clock: raise the core voltage first and let it settle;
+  // the build switches to a boot2 with a slower flash clock (CMakeLists.txt)
+  vreg_set_voltage(VREG_VOLTAGE_1_15);
+  busy_wait_us(1000);
+#endif
+  set_sys_clock_khz(RATE_SYS_CLOCK_KHZ, true);
+
+  // init device stack on native usb (roothub port0) before anything else,
+  // the console starts enumerating while the rest comes up
+  tud_init(BOARD_TUD_RHPORT);
+
+  // after the clock change so the UART baud rate is right
+  stdio_init_all();
 
-  sleep_ms(10);
+  // the bank is read in place through XIP, only the active profile is copied to RAM
+  profile_init((void const *) (XIP_BASE + PICO_FLASH_SIZE_BYTES - PROFILE_FLASH_SIZE));
+  switch_proto_init();
+  capture_init(REPORT_PERIOD_US, profile_active_index());
+  core0_idle_init();
+
+#if PICOPRO_TASK_TIMING
+  task_timing_init();
+#endif
 
   multicore_reset_core1();
   // all USB task run in core1
   multicore_launch_core1(core1_main);
 
-  // init device stack on native usb (roothub port0)
-  tud_init(BOARD_TUD_RHPORT);
-
+  // one task per pass, the most urgent first; the first report deadline is
+  // one period from here
+  sched_init(core0_tasks, CORE0_TASK_COUNT, time_us_32());
   while (true) {
-    tud_task(); // tinyusb device task
-    counter_task();
-    button_task();
-    fflush(stdout);
+#if PICOPRO_TASK_TIMING
+    task_timing_start_t const start = task_timing_now();
+#endif
+    int8_t const ran = sched_run(time_us_32());
+    if (ran < 0) core0_idle();
+#if PICOPRO_TASK_TIMING
+    else task_timing_add(core0_timing[ran], start);
+#endif
+    TASK_TIMING_LOOP();
   }
 
   return 0;
@@ -179,99 +234,36 @@ int main(void) {
 // USB HID
 //--------------------------------------------------------------------+
 
-// 3-byte package that holds the standard button report
-uint8_t final_buttons[] = { 0x00, 0x00, 0x00 };
-uint8_t imudata1a = 0x00;
-uint8_t imudata1b = 0x00;
-uint8_t imudata2a = 0x00;
-uint8_t imudata2b = 0x00;
-uint8_t imudata3a = 0x00;
-uint8_t imudata3b = 0x00;
-
-
-
-// neutral location for joystick?
-uint8_t joystick_neutral[] = {0xFF, 0xF7, 0x7F};
-uint8_t left_joystick[] = {0x00, 0x00, 0x00};
-
-uint8_t imu_data1[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-uint8_t imu_data2[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-uint8_t imu_data3[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-// Thanks to MIZUNO Yuki for these https://www.mzyy94.com/blog/2020/03/20/nintendo-switch-pro-controller-usb-gadget/
-uint8_t extended_mac_addr[] = { 0x00, 0x03, 0x00, 0x00, 0x5e, 0x00, 0x53, 0x5e };
-uint8_t serial_number[] = { 0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
-uint8_t controller_color[] = { 0x29, 0xA9, 0xA9, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
-uint8_t factory_sensor[] = { 0x50, 0xFD, 0x00, 0x00, 0xC6, 0x0F, 0x0F, 0x30, 0x61, 0x96, 0x30, 0xF3, 0xD4, 0x14, 0x54, 0x41, 0x15, 0x54, 0xC7, 0x79, 0x9C, 0x33, 0x36, 0x63 };
-uint8_t factory_stick[] = { 0x0F, 0x30, 0x61, 0x96, 0x30, 0xF3, 0xD4, 0x14, 0x54, 0x41, 0x15, 0x54, 0xC7, 0x79, 0x9C, 0x33, 0x36, 0x63 };
-uint8_t factory_config[] = { 0xBA, 0x15, 0x62, 0x11, 0xB8, 0x7F, 0x29, 0x06, 0x5B, 0xFF, 0xE7, 0x7E, 0x0E, 0x36, 0x56, 0x9E, 0x85, 0x60, 0xFF, 0x32, 0x32, 0x32, 0xFF, 0xFF, 0xFF };
-uint8_t user_stick[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xB2, 0xA1 };
-uint8_t user_motion[] = { 0xBE, 0xFF, 0x3E, 0x00, 0xF0, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x40, 0xFE, 0xFF, 0xFE, 0xFF, 0x08, 0x00, 0xE7, 0x3B, 0xE7, 0x3B, 0xE7, 0x3B };
-uint8_t nfc_ir[] = { 0x01, 0x00, 0xFF, 0x00, 0x03, 0x00, 0x05, 0x01 };
-uint8_t initial_input[] = { 0x81, 0x00, 0x80, 0x00, 0xf8, 0xd7, 0x7a, 0x22, 0xc8, 0x7b, 0x0c };
-uint8_t info_from_device[] = {0x03,0x48,0x03,0x02,0xe5,0x35,0x00,0xe5,0x00,0x00,0x03,0x01 };
-
-bool ok_to_send_presses = false;
-int counter = 0;
-bool mutex_held = false;
 bool a_press = false;
 
-void response(uint8_t command, uint8_t response, uint8_t *buffer, size_t buffer_len) {
-    mutex_held = true;
-    uint8_t report[64] = {0};
-    report[0] = command;
-    report[1] = response;
-    memcpy(report + 2, buffer, buffer_len);
-    // printf("To Switch: ");
-    // for (int i = 0; i < 64; i++)
-    // {
-    //     printf("%02X", report[i]);
-    // }
-    // printf("\n");
-    tud_hid_report(0, report, 64);
-    mutex_held = false;
-}
-
-void uart_response(uint8_t command, uint8_t subcommand, uint8_t *buffer, size_t buffer_len) {
-    uint8_t buf[64] = {0};
-    memcpy(buf, (uint8_t *)initial_input, sizeof(initial_input));
-    buf[sizeof(initial_input)] = command;
-    buf[sizeof(initial_input) + 1] = subcommand;
-    memcpy(buf + 2 + sizeof(initial_input), (uint8_t *)buffer, buffer_len);
-    response(0x21, counter, (uint8_t *)buf, sizeof(initial_input) + 2 + buffer_len);
-}
-
-
-void spi_response(uint8_t *addr, uint8_t *buffer, size_t buffer_len) {
-    uint8_t buf[64] = {0};
-    memcpy(buf, addr, 2);
-    buf[2] = 0x00;
-    buf[3] = 0x00;
-    buf[4] = buffer_len;
-    memcpy(buf + 5, buffer, buffer_len);
-    uart_response(0x90, 0x10, (uint8_t *)buf, 5 + buffer_len);
+// Invoked when the console has configured the device
+void tud_mount_cb(void)
+{
+  boot_metrics_mark(BOOT_MARK_ENUMERATED);
 }
 
-
 // Invoked when received GET_REPORT control request
 // Application must fill buffer report's content and return its length.
 // Return zero will cause the stack to STALL request
 uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer, uint16_t reqlen)
 {
-  // TODO not Implemented
   (void) itf;
-  (void) report_id;
   (void) report_type;
-  (void) buffer;
-  (void) reqlen;
 
-  return 0;
+  // only the vendor telemetry reports (telemetry.h, task_timing.h) can be read
+#if PICOPRO_TASK_TIMING
+  uint16_t const len = task_timing_get_report(report_id, buffer, reqlen);
+  if (len) return len;
+#endif
+  return telemetry_get_report(report_id, buffer, reqlen);
 }
 
 // Invoked when received SET_REPORT control request or
 // received data on OUT endpoint ( Report ID = 0, Type = 0 )
-void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize)
+void __not_in_flash_func(tud_hid_set_report_cb)(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize)
 {
+  TASK_TIMING_BEGIN(SET_REPORT_CB);
+
   // This example doesn't use multiple report and report ID
   (void) itf;
   (void) report_id;
@@ -284,66 +276,58 @@ void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t rep
   // }
   // printf("\n");
 
-  // Thanks to MIZUNO Yuki for this code https://www.mzyy94.com/blog/2020/03/20/nintendo-switch-pro-controller-usb-gadget/
-  if (buffer[0] == 0x80) {
-      if (buffer[1] == 0x01) {
-          response(0x81, 0x01, (uint8_t *)extended_mac_addr, sizeof(extended_mac_addr));
-      } 
-      else if (buffer[1] == 0x02) {
-          response(0x81, 0x02, (uint8_t *)0x00, 1);
-      }
-      else if (buffer[1] == 0x03) {
-          printf("baud update\n");
-          response(0x81, 0x03, (uint8_t *)0x00, 1);
-      }
-      else if (buffer[1] == 0x04) {
-          ok_to_send_presses = true;
-      }  
-  }
-  else if (buffer[0] == 0x01) {
-      if (buffer[10] == 0x01) {
-          uart_response(0x81, buffer[10], (uint8_t[]){0x03}, 1);
-      } else if (buffer[10] == 0x02) {
-          uart_response(0x82, buffer[10], (uint8_t *)info_from_device, sizeof(info_from_device));
-      } else if (buffer[10] == 0x03 || buffer[10] == 0x08 || buffer[10] == 0x30 || buffer[10] == 0x38 || buffer[10] == 0x40 || buffer[10] == 0x48) {
-          uart_response(0x80, buffer[10], NULL, 0);
-      } else if (buffer[10] == 0x04) {
-          uart_response(0x83, buffer[10], NULL, 0);
-      } else if (buffer[10] == 0x21) { //NFC / IR communcation
-          uart_response(0xa0, buffer[10], (uint8_t *)nfc_ir, 8);
-      } 
-      else if (buffer[10] == 0x10) {
-          if (memcmp(buffer + 11, "\x00\x60", 2) == 0) { // Serial Number
-              spi_response(buffer + 11, (uint8_t *)serial_number, 16);
-          } else if (memcmp(buffer + 11, "\x50\x60", 2) == 0) { // Controller Color
-              spi_response(buffer + 11, (uint8_t *)controller_color, 13);
-          } else if (memcmp(buffer + 11, "\x80\x60", 2) == 0) { // Factory Sensor
-              spi_response(buffer + 11, (uint8_t *)factory_sensor, 24);
-          } else if (memcmp(buffer + 11, "\x98\x60", 2) == 0) { // Factory Stick
-              spi_response(buffer + 11, (uint8_t *)factory_stick, 18);
-          } else if (memcmp(buffer + 11, "\x3d\x60", 2) == 0) { // Factory configuration
-              spi_response(buffer + 11, (uint8_t *)factory_config, 25);
-          } else if (memcmp(buffer + 11, "\x10\x80", 2) == 0) { // User sticks calibration
-              spi_response(buffer + 11, (uint8_t *)user_stick, 24);
-          } else if (memcmp(buffer + 11, "\x28\x80", 2) == 0) { // User motion calibration
-              spi_response(buffer + 11, (uint8_t *)user_motion, 24);
-          } else {
-              printf("Unknown SPI address: %s\n", buffer + 11);
-          }
-      }
-      else if (buffer[0] == 0x10 && sizeof(buffer) == 10) {
-              // Do nothing
-      }
-      else {
-      printf("unhandled\n");
-      }
-  }
+  switch_proto_output(buffer, bufsize, switch_proto_timer(time_us_64()));
+
+  TASK_TIMING_END(SET_REPORT_CB);
 }
 
 //--------------------------------------------------------------------+
 // Host HID
 //--------------------------------------------------------------------+
 
+// Raw reports from core1, decoded on core0 by hid_task()
+static hid_ring_t hid_ring;
+
+// Publish the entry and ring core0's doorbell: SEV wakes it from WFE in
+// core0_idle(). The SIO FIFO is left alone, multicore_lockout owns it.
+static inline void hid_ring_publish(void)
+{
+  hid_ring_commit(&hid_ring);
+  __sev();
+}
+
+_Static_assert(sizeof(kbd_layout_t) <= HID_RING_REPORT_MAX, "kbd_layout_t must fit in a mount record");
+_Static_assert(sizeof(mouse_layout_t) <= HID_RING_REPORT_MAX, "mouse_layout_t must fit in a mount record");
+
+// True if the report descriptor has a top-level Generic Desktop collection of usage
+static bool has_collection(uint8_t const* desc_report, uint16_t desc_len, uint8_t usage)
+{
+  tuh_hid_report_info_t info[4];
+  uint8_t const count = tuh_hid_parse_report_descriptor(info, 4, desc_report, desc_len);
+  for (uint8_t i = 0; i < count; i++) {
+    if (info[i].usage_page == HID_USAGE_PAGE_DESKTOP && info[i].usage == usage) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Tell core0 how to decode the interface's reports
+static void push_mount(uint8_t dev_addr, uint8_t instance, uint8_t protocol, void const* layout, uint8_t len)
+{
+  hid_ring_entry_t *entry = hid_ring_acquire(&hid_ring);
+  if (entry) {
+    entry->time_us = time_us_64();
+    entry->kind = HID_RING_MOUNT;
+    entry->dev_addr = dev_addr;
+    entry->instance = instance;
+    entry->protocol = protocol;
+    entry->len = len;
+    memcpy(entry->data, layout, len);
+    hid_ring_publish();
+  }
+}
+
 // Invoked when device with hid interface is mounted
 // Report descriptor is also available for use. tuh_hid_parse_report_descriptor()
 // can be used to parse common/simple enough descriptor.
@@ -351,343 +335,360 @@ void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t rep
 // therefore report_desc = NULL, desc_len = 0
 void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_report, uint16_t desc_len)
 {
-  (void)desc_report;
-  (void)desc_len;
+  TASK_TIMING_BEGIN(MOUNT_CB);
 
   // Interface protocol (hid_interface_protocol_enum_t)
-  const char* protocol_str[] = { "None", "Keyboard", "Mouse" };
   uint8_t const itf_protocol = tuh_hid_interface_protocol(dev_addr, instance);
 
   uint16_t vid, pid;
   tuh_vid_pid_get(dev_addr, &vid, &pid);
+  LOG_INFO(HID_MOUNT, vid, pid, dev_addr, instance);
+
+  // Work out where the keys are. Report-protocol keyboards don't have to
+  // follow the boot layout, and NKRO keyboards often sit on a non-boot
+  // interface with a bitmap report.
+  bool const boot = tuh_hid_get_protocol(dev_addr, instance) == HID_PROTOCOL_BOOT;
+  kbd_layout_t layout;
+  bool is_keyboard = false;
+  if (itf_protocol == HID_ITF_PROTOCOL_KEYBOARD) {
+    if (boot || !kbd_layout_parse(&layout, desc_report, desc_len)) {
+      kbd_layout_boot(&layout);
+    }
+    is_keyboard = true;
+  }
+  else if (itf_protocol == HID_ITF_PROTOCOL_NONE && has_collection(desc_report, desc_len, HID_USAGE_DESKTOP_KEYBOARD)) {
+    is_keyboard = kbd_layout_parse(&layout, desc_report, desc_len);
+  }
 
-  char tempbuf[256];
-  int count = sprintf(tempbuf, "[%04x:%04x][%u] HID Interface%u, Protocol = %s\r\n", vid, pid, dev_addr, instance, protocol_str[itf_protocol]);
-  printf(tempbuf);
-  fflush(stdout);
+  // Same for mice: gaming mice send 12/16-bit deltas in report protocol
+  mouse_layout_t mouse;
+  bool is_mouse = false;
+  if (itf_protocol == HID_ITF_PROTOCOL_MOUSE) {
+    if (boot || !mouse_layout_parse(&mouse, desc_report, desc_len)) {
+      mouse_layout_boot(&mouse);
+    }
+    is_mouse = true;
+  }
+  else if (itf_protocol == HID_ITF_PROTOCOL_NONE && has_collection(desc_report, desc_len, HID_USAGE_DESKTOP_MOUSE)) {
+    is_mouse = mouse_layout_parse(&mouse, desc_report, desc_len);
+  }
 
-  // Receive report from boot keyboard & mouse only
+  LOG_INFO(HID_LAYOUT, dev_addr, instance, is_keyboard, is_mouse);
+
+  // Receive report from keyboards & mice only
   // tuh_hid_report_received_cb() will be invoked when report is available
-  if (itf_protocol == HID_ITF_PROTOCOL_KEYBOARD || itf_protocol == HID_ITF_PROTOCOL_MOUSE)
+  if (is_keyboard || is_mouse)
   {
+    if (is_keyboard) push_mount(dev_addr, instance, HID_ITF_PROTOCOL_KEYBOARD, &layout, sizeof(layout));
+    if (is_mouse) push_mount(dev_addr, instance, HID_ITF_PROTOCOL_MOUSE, &mouse, sizeof(mouse));
+
     if ( !tuh_hid_receive_report(dev_addr, instance) )
     {
-      printf("Error: cannot request report\r\n");
+      LOG_ERROR(HID_NO_REPORT, dev_addr, instance);
     }
   }
+
+  TASK_TIMING_END(MOUNT_CB);
 }
 
 // Invoked when device with hid interface is un-mounted
 void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance)
 {
-  char tempbuf[256];
-  int count = sprintf(tempbuf, "[%u] HID Interface%u is unmounted\r\n", dev_addr, instance);
-  printf(tempbuf);
-  fflush(stdout);
+  LOG_INFO(HID_UMOUNT, dev_addr, instance);
+
+  hid_ring_entry_t *entry = hid_ring_acquire(&hid_ring);
+  if (entry) {
+    entry->time_us = time_us_64();
+    entry->kind = HID_RING_UMOUNT;
+    entry->dev_addr = dev_addr;
+    entry->instance = instance;
+    entry->protocol = HID_ITF_PROTOCOL_NONE;
+    entry->len = 0;
+    hid_ring_publish();
+  }
 }
 
-// check to see if the modifier appears in the report
-static inline bool find_modifier_in_report(hid_keyboard_report_t const *report, uint8_t modifier)
+// Invoked when received report from device via interrupt endpoint
+// Runs on core1 inside tuh_task(): only copy the report out so the endpoint
+// can be re-armed straight away, decoding happens on core0.
+void __not_in_flash_func(tuh_hid_report_received_cb)(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len)
 {
-  if (report->modifier == modifier) {
-    return true;
+  TASK_TIMING_BEGIN(REPORT_RECEIVED_CB);
+
+  hid_ring_entry_t *entry = hid_ring_acquire(&hid_ring);
+  if (entry) {
+    if (len > HID_RING_REPORT_MAX) len = HID_RING_REPORT_MAX;
+    entry->time_us = time_us_64();
+    entry->kind = HID_RING_REPORT;
+    entry->dev_addr = dev_addr;
+    entry->instance = instance;
+    entry->protocol = tuh_hid_interface_protocol(dev_addr, instance);
+    entry->len = (uint8_t) len;
+    memcpy(entry->data, report, len);
+    hid_ring_publish();
   }
-  return false;
-}
 
-// check to see if the keycode appears in the report
-static inline bool find_key_in_report(hid_keyboard_report_t const *report, uint8_t keycode)
-{
-  for(uint8_t i=0; i<6; i++)
+  // continue to request to receive report
+  if ( !tuh_hid_receive_report(dev_addr, instance) )
   {
-    if (report->keycode[i] == keycode) {
-      return true;
-    }
+    LOG_ERROR(HID_NO_REPORT, dev_addr, instance);
   }
-  return false;
-}
 
-// Convert joystick values ranging from 0 to 2047 (neutral) to 4095 (max, higher numbers will overflow)
-void to_joystick(int horiz, int vert, uint8_t *data) {
-    uint8_t byte0 = horiz & 0x00FF; // mask out high byte to get low byte
-    uint8_t byte1nibblelow = (horiz >> 8) & 0x000F; // bitshift high byte to low byte and mask out all but lowest nibble
-    uint8_t byte1nibblehigh = (vert & 0x000F) << 4; // mask out all but lowest nibble and bitshift it to high nibble
-    uint8_t byte1 = byte1nibblelow | byte1nibblehigh; // bitwise or together middle nibbles
-    uint8_t byte2 = (vert >> 4) & 0x00FF; // bitshift all bytes by one nibble and mask out high byte to get low byte
-    data[0] = byte0;
-    data[1] = byte1;
-    data[2] = byte2;
+  TASK_TIMING_END(REPORT_RECEIVED_CB);
 }
 
-int vert = 2047;
-int horiz = 2047;
-int offset = 2047;
+// Set when a key or button changed since the last report was built
+static bool held_changed = false;
 
-// convert hid keycode to ascii
-static void process_kbd_report(uint8_t dev_addr, hid_keyboard_report_t const *report)
+bool __not_in_flash_func(hid_pending)(void)
 {
-  (void) dev_addr;
-  static hid_keyboard_report_t prev_report = { 0, 0, {0} }; // previous report to check key released
-  // start by assuming the bytes are all zeros (all released)
-  uint8_t buttons[] = { 0x00, 0x00, 0x00 };
-  // container for change mask, where bit will be set to 1 if it _changes_ (this could be from 1 to 0 or from 0 to 1)
-  uint8_t buttons_change_mask[] = { 0x00, 0x00, 0x00 };
-  // neutral location for joystick?
-  memcpy(left_joystick, joystick_neutral, sizeof(joystick_neutral));
-
-  /////////////////////////////////////////////////////////////////////////////////////////////////
-  //CHECK MODIFIER (BYTE 0)
-  /////////////////////////////////////////////////////////////////////////////////////////////////
-  // check modifier byte to see if any modifier keys are pressed
-  int8_t modifier = report->modifier;
-  if (modifier) {
-    if (find_modifier_in_report(&prev_report, modifier)) {
-      // if the modifier exists in the previous report, it is being held down
-    }
-    else {
-      // modifier exists in current but not previous report, so it is being first pressed
-      buttonLocation loc = findModifierMap(modifierMap, sizeof(modifierMap) / sizeof(modifierMap[0]), modifier);
-      printf("Pressed: Byte %d, Shift %d\r\n",loc.byte, loc.shift);
-      if (loc.byte != -1 && loc.shift != -1) {
-        buttons[loc.byte] = buttons[loc.byte] | 1 << loc.shift;
-        buttons_change_mask[loc.byte] = buttons_change_mask[loc.byte] | 1 << loc.shift;
+  return hid_ring_peek(&hid_ring) != NULL;
+}
+
+// Drain reports queued by core1 and fold them into the controller state.
+// Runs on core0 so report building never sees a half-updated state.
+void __not_in_flash_func(hid_task)(void)
+{
+  hid_ring_entry_t const *entry;
+  while ((entry = hid_ring_peek(&hid_ring)) != NULL) {
+    capture_input(entry->kind, (uint32_t) entry->time_us, entry->dev_addr, entry->instance,
+                  entry->protocol, entry->data, entry->len);
+    switch (entry->kind)
+    {
+      case HID_RING_MOUNT:
+        input_mount(entry->dev_addr, entry->instance, entry->protocol, entry->data);
+      break;
+
+      case HID_RING_UMOUNT:
+        input_umount(entry->dev_addr, entry->instance);
+        held_changed = true;
+      break;
+
+      case HID_RING_REPORT: {
+        uint8_t const changed = input_report(entry->dev_addr, entry->instance, (uint32_t) entry->time_us,
+                                             entry->data, entry->len);
+        if (changed) telemetry_input_edge((uint32_t) entry->time_us);
+        if (changed & INPUT_CHANGED_HELD) held_changed = true;
       }
-    }
+      break;
 
-  }
-  // Check for modifier released
-  uint8_t prev_modifier = prev_report.modifier;
-  if ( prev_modifier && !find_modifier_in_report(report, prev_modifier) )
-  {
-    // modifier existed in previous report but not in current report, so this means the modifier is released
-    buttonLocation loc = findModifierMap(modifierMap, sizeof(modifierMap) / sizeof(modifierMap[0]), prev_modifier);
-    printf("Released: Byte %d, Shift %d\r\n",loc.byte, loc.shift);
-    if (loc.byte != -1 && loc.shift != -1) {
-      buttons[loc.byte] = buttons[loc.byte] | 0 << loc.shift;
-      buttons_change_mask[loc.byte] = buttons_change_mask[loc.byte] | 1 << loc.shift;
+      default: break;
     }
+    hid_ring_release(&hid_ring);
   }
+  telemetry_counters.ring_dropped = hid_ring.dropped;
+}
+
+//--------------------------------------------------------------------+
+// Profile upload
+//--------------------------------------------------------------------+
 
-  /////////////////////////////////////////////////////////////////////////////////////////////////
-  //CHECK KEYS (BYTES 2-7)
-  /////////////////////////////////////////////////////////////////////////////////////////////////
-  // check all 6 elements of the report to see if any of the corresponding keys are pressed
-  for(uint8_t i=0; i<6; i++)
+// Rewrite the reserved profile sectors at the end of flash
+bool profile_flash_save(void const *bank, uint32_t len)
+{
+  uint32_t const offset = PICO_FLASH_SIZE_BYTES - PROFILE_FLASH_SIZE;
+  if (len != PROFILE_FLASH_SIZE) return false;
+
+  // core1 executes from flash too, so hold it off while XIP is unavailable
+  multicore_lockout_start_blocking();
+  uint32_t const ints = save_and_disable_interrupts();
+  flash_range_erase(offset, PROFILE_FLASH_SIZE);
+  flash_range_program(offset, (uint8_t const *) bank, PROFILE_FLASH_SIZE);
+  restore_interrupts(ints);
+  multicore_lockout_end_blocking();
+  return true;
+}
+
+#if CFG_TUD_CDC
+bool cdc_pending(void)
+{
+  return tud_cdc_available() > 0;
+}
+
+void cdc_task(void)
+{
+  uint8_t buf[64];
+  uint8_t reply[64];
+
+  while ( tud_cdc_available() )
   {
-    uint8_t keycode = report->keycode[i];
-    if (keycode) {
-      if (find_key_in_report(&prev_report, keycode)) {
-        // if the key exists in the previous report, it is being held down
-      }
-      else {
-        // key exists in current but not previous report, so it is being first pressed
-        bool const is_shift = report->modifier & (KEYBOARD_MODIFIER_LEFTSHIFT | KEYBOARD_MODIFIER_RIGHTSHIFT);
-        //char ch = is_shift ? keycode2ascii[keycode][1] : keycode2ascii[keycode][0];
-        char ch = keycode2ascii[keycode][0];
-        //printf("%c: ",ch);
-        buttonLocation loc = findKeyMap(keyMap, sizeof(keyMap) / sizeof(keyMap[0]), ch);
-        if (loc.byte != -1 && loc.shift != -1) {
-          if (loc.byte == 3) {
-            if (loc.shift == 0) {
-              //vert = 4095;
-              vert+=offset;
-            }
-            else if (loc.shift == 1) {
-              //vert = 0;
-              vert-=offset;
-            }
-            else if (loc.shift == 2) {
-              //horiz = 0;
-              horiz-=offset;
-            }
-            else if (loc.shift == 3) {
-              //horiz = 4095;
-              horiz+=offset;
-            }
-          }
-          else {
-            buttons[loc.byte] = buttons[loc.byte] | 1 << loc.shift;
-            buttons_change_mask[loc.byte] = buttons_change_mask[loc.byte] | 1 << loc.shift;
-          }
-          //printf("%d\r\n",loc.shift);
-        }
-        else {
-          //printf("not in mapping\r\n");
-        }
-        //fflush(stdout);
-      }
-    }
-    // Check for key released
-    uint8_t prev_keycode = prev_report.keycode[i];
-    if ( prev_keycode && !find_key_in_report(report, prev_keycode) )
-    {
-      // key existed in previous report but not in current report, so this means the key is released
-      char ch = keycode2ascii[prev_keycode][0];
-      buttonLocation loc = findKeyMap(keyMap, sizeof(keyMap) / sizeof(keyMap[0]), ch);
-        if (loc.byte != -1 && loc.shift != -1) {
-          if (loc.byte == 3) {
-            if (loc.shift == 0) {
-              //vert = 2047;
-              vert-=offset;
-            }
-            else if (loc.shift == 1) {
-              //vert = 2047;
-              vert+=offset;
-            }
-            else if (loc.shift == 2) {
-              //horiz = 2047;
-              horiz+=offset;
-            }
-            else if (loc.shift == 3) {
-              //horiz = 2047;
-              horiz-=offset;
-            }
-          }
-          else {
-            buttons[loc.byte] = buttons[loc.byte] | 0 << loc.shift;
-            buttons_change_mask[loc.byte] = buttons_change_mask[loc.byte] | 1 << loc.shift;
-          }
-          //printf("%d\r\n",loc.shift);
-        }
-        else {
-          //printf("not in mapping\r\n");
-        }
-        //fflush(stdout);
-      
+    uint32_t const count = tud_cdc_read(buf, sizeof(buf));
+    uint32_t const reply_len = profile_upload_feed(buf, count, reply, sizeof(reply));
+    if (reply_len) {
+      tud_cdc_write(reply, reply_len);
+      tud_cdc_write_flush();
     }
   }
+}
 
-  //printf("0x%02hhx\r\n", thirdbyte);
-  //fflush(stdout);
-  final_buttons[0] = (final_buttons[0] & ~buttons_change_mask[0]) | (buttons[0] & buttons_change_mask[0]);
-  final_buttons[1] = (final_buttons[1] & ~buttons_change_mask[1]) | (buttons[1] & buttons_change_mask[1]);
-  final_buttons[2] = (final_buttons[2] & ~buttons_change_mask[2]) | (buttons[2] & buttons_change_mask[2]);
+// Invoked when cdc when line state changed e.g connected/disconnected
+void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts)
+{
+  (void) itf;
+  (void) rts;
 
-  to_joystick(horiz, vert, left_joystick);
-  prev_report = *report;
+  // a closed port abandons any half-received frame
+  if (!dtr) profile_upload_reset();
 }
+#endif
 
-int16_t x_current_hid = 0;
-int16_t y_current_hid = 0;
-// send mouse report 
-static void process_mouse_report(uint8_t dev_addr, hid_mouse_report_t const * report)
+//--------------------------------------------------------------------+
+// BUTTON TASK
+//--------------------------------------------------------------------+
+
+// Reports go out on every deadline (report_frame_task). A press or release
+// in between gets a refresh report straight away, so it doesn't wait up to a
+// whole period; the deadlines keep their cadence and stay the only frames
+// that step macros, ramps and motion (pro_report_refresh()).
+static void __not_in_flash_func(send_report)(bool frame)
 {
-  uint8_t buttons[] = { 0x00, 0x00, 0x00 };
-  uint8_t buttons_change_mask[] = { 0x00, 0x00, 0x00 };
-
-  //------------- button state  -------------//
-  //uint8_t button_changed_mask = report->buttons ^ prev_report.buttons;
-  char l = report->buttons & MOUSE_BUTTON_LEFT   ? 'L' : '-';
-  char m = report->buttons & MOUSE_BUTTON_MIDDLE ? 'M' : '-';
-  char r = report->buttons & MOUSE_BUTTON_RIGHT  ? 'R' : '-';
-  char b = report->buttons & MOUSE_BUTTON_BACKWARD  ? 'B' : '-';
-  char f = report->buttons & MOUSE_BUTTON_FORWARD ? 'F' : '-';
-
-  // char tempbuf[32];
-  // int count = sprintf(tempbuf, "[%u] %c%c%c%c%c %d %d %d\r\n", dev_addr, l, m, r, b, f, report->x, report->y, report->wheel);  
-  // printf(tempbuf);
-  // fflush(stdout);
-
-  //x is inverted
-  x_current_hid += (report->x)*-1;
-  y_current_hid += (report->y)*1;
-
-  if (l == 'L') {
-    char ch = 'z';
-    buttonLocation loc = findKeyMap(keyMap, sizeof(keyMap) / sizeof(keyMap[0]), ch);
-    buttons[loc.byte] = buttons[loc.byte] | 1 << loc.shift;
-    buttons_change_mask[loc.byte] = buttons_change_mask[loc.byte] | 1 << loc.shift;
+  held_changed = false;
+  if (!switch_proto_input_enabled()) return;
+
+  // the timer byte comes from the same instant the report is built for
+  uint64_t const now = time_us_64();
+  uint32_t const now_us = (uint32_t) now;
+  uint8_t const timer = switch_proto_timer(now);
+  uint8_t const *report;
+  if (frame) {
+    report = pro_report_build(timer, now_us, REPORT_PERIOD_US);
   }
   else {
-    char ch = 'z';
-    buttonLocation loc = findKeyMap(keyMap, sizeof(keyMap) / sizeof(keyMap[0]), ch);
-    buttons[loc.byte] = buttons[loc.byte] | 0 << loc.shift;
-    buttons_change_mask[loc.byte] = buttons_change_mask[loc.byte] | 1 << loc.shift;
+    report = pro_report_refresh(timer);
+    telemetry_counters.refreshes++;
   }
-  final_buttons[0] = (final_buttons[0] & ~buttons_change_mask[0]) | (buttons[0] & buttons_change_mask[0]);
-  final_buttons[1] = (final_buttons[1] & ~buttons_change_mask[1]) | (buttons[1] & buttons_change_mask[1]);
-  final_buttons[2] = (final_buttons[2] & ~buttons_change_mask[2]) | (buttons[2] & buttons_change_mask[2]);
+  capture_frame(now_us, timer, profile_active_index(), !frame, report, PRO_REPORT_SIZE);
+  // replaces any input report still waiting, replies keep going out first,
+  // and tud_hid_report_complete_cb() sends it as soon as the endpoint is free
+  report_queue_set_input(report);
+  report_queue_kick();
 }
 
-// Invoked when received report from device via interrupt endpoint
-void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len)
+void __not_in_flash_func(report_frame_task)(void)
 {
-  (void) len;
-  uint8_t const itf_protocol = tuh_hid_interface_protocol(dev_addr, instance);
+  // the scheduler skips deadlines the loop was too late for, never sends a burst
+  telemetry_counters.late_frames = sched_missed(CORE0_FRAME);
+  send_report(true);
+}
 
-  switch(itf_protocol)
-  {
-    case HID_ITF_PROTOCOL_KEYBOARD:
-      process_kbd_report(dev_addr, (hid_keyboard_report_t const*) report );
-    break;
+// A refresh waits for the endpoint to take the report before it: a frame
+// still waiting carries drained motion and a macro step and must not be
+// replaced. Then it goes out with the newest state.
+bool __not_in_flash_func(report_refresh_pending)(void)
+{
+  return held_changed && !report_queue_input_pending();
+}
+
+void __not_in_flash_func(report_refresh_task)(void)
+{
+  send_report(false);
+}
+
+//--------------------------------------------------------------------+
+// Input capture
+//--------------------------------------------------------------------+
 
-    case HID_ITF_PROTOCOL_MOUSE:
-      process_mouse_report(dev_addr, (hid_mouse_report_t const*) report );
-    break;
+// Send 'D' on the UART to dump the capture ring (capture.h). The dump is
+// written raw, bypassing stdio's newline translation, and only as fast as
+// the UART FIFO drains so the USB tasks keep running meanwhile.
+bool capture_pending(void)
+{
+  return capture_dumping() ? uart_is_writable(uart_default) : uart_is_readable(uart_default);
+}
 
-    default: break;
+void capture_task(void)
+{
+  if (!capture_dumping()) {
+    if (uart_is_readable(uart_default) && uart_getc(uart_default) == 'D') {
+      capture_dump_begin(hid_ring.dropped);
+    }
+    return;
   }
 
-  // continue to request to receive report
-  if ( !tuh_hid_receive_report(dev_addr, instance) )
-  {
-    printf("Error: cannot request report\r\n");
+  uint8_t byte;
+  while (uart_is_writable(uart_default) && capture_dump_read(&byte, 1)) {
+    uart_putc_raw(uart_default, byte);
   }
 }
 
+//--------------------------------------------------------------------+
+// Log drain
+//--------------------------------------------------------------------+
+
+// Format logged records (log_ring.h) and feed them to the UART only as far
+// as its FIFO has room, so a busy UART never stalls the loop. Holds off
+// while a capture dump owns the UART.
+static char log_line[LOG_LINE_MAX];
+static size_t log_len = 0;
+static size_t log_sent = 0;
 
+bool log_task_pending(void)
+{
+  if (capture_dumping() || !uart_is_writable(uart_default)) return false;
+  return log_sent != log_len || log_pending();
+}
+
+void log_task(void)
+{
+  while (uart_is_writable(uart_default)) {
+    if (log_sent == log_len) {
+      log_record_t record;
+      if (!log_pop(&record)) return;
+      log_len = log_format(&record, log_line, sizeof(log_line));
+      log_sent = 0;
+    }
+    else {
+      uart_putc_raw(uart_default, log_line[log_sent++]);
+    }
+  }
+}
 
 //--------------------------------------------------------------------+
-// COUNTER AND BUTTON TASKS
+// Idle
 //--------------------------------------------------------------------+
-void counter_task(void)
+
+// When no task is runnable core0 sleeps in WFE, which also leaves the bus to
+// core1's PIO-USB work. Whatever can give it work wakes it: a hardware
+// alarm at the next deadline and the USB interrupt through SEVONPEND, core1
+// through the doorbell in hid_ring_publish(). An event raised after
+// sched_run() looked is latched, so the WFE returns at once.
+//
+// The UART raises no interrupt and is polled at least once per report
+// period; while a dump or a log line is going out core0 keeps spinning so
+// the FIFO never runs dry.
+#if PICOPRO_REPORT_ALARM
+static uint deadline_alarm;
+
+// only there so the alarm interrupt is taken
+static void deadline_alarm_cb(uint alarm_num)
 {
-  static uint32_t start_ms = 0;
-  // Blink every interval ms
-  if ( to_ms_since_boot(get_absolute_time()) - start_ms < 30) return; // not enough time
-  start_ms += 30;
-  counter = (counter + 3) % 256;
+  (void) alarm_num;
 }
 
-int16_t x_delta = 0;
-int16_t x_last = 0;
-int16_t y_delta = 0;
-int16_t y_last = 0;
-void button_task(void)
+void core0_idle_init(void)
 {
-  static uint32_t start_ms = 0;
-  // Blink every interval ms
-  if (( to_ms_since_boot(get_absolute_time()) - start_ms < 30) || mutex_held == true || ok_to_send_presses == false) return; // not enough time
-  start_ms += 30;
-  x_delta = (x_current_hid - x_last)*1;
-  x_last = x_current_hid;
-  y_delta = (y_current_hid - y_last)*0.1;
-  y_last = y_current_hid;
-
-
-  // convert all the deltas to little endian
-  imu_data1[10] = (x_delta >> 8 & 0xFF);
-  imu_data1[11] = (x_delta & 0xFF);
-  imu_data2[10] = (x_delta >> 8 & 0xFF);
-  imu_data2[11] = (x_delta & 0xFF);
-  imu_data3[10] = (x_delta >> 8 & 0xFF);
-  imu_data3[11] = (x_delta & 0xFF);
-
-  // convert all the deltas to little endian
-  imu_data1[8] = (y_delta >> 8 & 0xFF);
-  imu_data1[9] = (y_delta & 0xFF);
-  imu_data2[8] = (y_delta >> 8 & 0xFF);
-  imu_data2[9] = (y_delta & 0xFF);
-  imu_data3[8] = (y_delta >> 8 & 0xFF);
-  imu_data3[9] = (y_delta & 0xFF);
-  
-  //uint8_t test_button_response[] = { 0x81, final_thirdbyte, 0x80, 0x00, 0xf8, 0xd7, 0x7a, 0x22, 0xc8, 0x7b, 0x0c };
-  uint8_t test_button_response[] = { 0x81, final_buttons[0], final_buttons[1], final_buttons[2], left_joystick[0], left_joystick[1], left_joystick[2], 0x22, 0xc8, 0x7b, 0x0c };
-  uint8_t buttons_and_joysticks[] = { 0x81, final_buttons[0], final_buttons[1], final_buttons[2], left_joystick[0], left_joystick[1], left_joystick[2], 0x22, 0xc8, 0x7b, 0x0c };
-  uint8_t final_response[sizeof(buttons_and_joysticks) + sizeof(imu_data1) + sizeof(imu_data2) + sizeof(imu_data3)];
-  memcpy(final_response,buttons_and_joysticks, sizeof(buttons_and_joysticks) * sizeof(uint8_t));
-  memcpy(final_response+sizeof(buttons_and_joysticks),imu_data1, sizeof(imu_data1) * sizeof(uint8_t));
-  memcpy(final_response+sizeof(buttons_and_joysticks)+sizeof(imu_data1),imu_data2, sizeof(imu_data2) * sizeof(uint8_t));
-  memcpy(final_response+sizeof(buttons_and_joysticks)+sizeof(imu_data1)+sizeof(imu_data2),imu_data3, sizeof(imu_data3) * sizeof(uint8_t));
-  response(0x30, counter, (uint8_t *)final_response, sizeof(final_response));
-}
\ No newline at end of file
+  // any interrupt wakes core0 from WFE, even one that fired just before it
+  scb_hw->scr |= M0PLUS_SCR_SEVONPEND_BITS;
+  deadline_alarm = (uint) hardware_alarm_claim_unused(true);
+  hardware_alarm_set_callback(deadline_alarm, deadline_alarm_cb);
+}
+
+void core0_idle(void)
+{
+  if (capture_dumping() || log_sent != log_len) return;
+
+  uint32_t const now = time_us_32();
+  uint32_t const wait = sched_next_deadline(now) - now;
+  // true if the deadline has already gone by
+  if (hardware_alarm_set_target(deadline_alarm, delayed_by_us(get_absolute_time(), wait))) return;
+  __wfe();
+}
+#else
+void core0_idle_init(void)
+{
+}
+
+void core0_idle(void)
+{
+}
+#endif
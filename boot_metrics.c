@@ -0,0 +1,72 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "pico/platform.h"
+#include "pico/time.h"
+#include "boot_metrics.h"
+#include "log_ring.h"
+
+boot_metrics_t __uninitialized_ram(boot_metrics);
+
+static bool printed = false;
+
+void boot_metrics_init(void)
+{
+  if (boot_metrics.magic == BOOT_METRICS_MAGIC) {
+    boot_metrics.previous = boot_metrics.current;
+    boot_metrics.boot_count++;
+  }
+  else {
+    memset(&boot_metrics, 0, sizeof(boot_metrics));
+    boot_metrics.magic = BOOT_METRICS_MAGIC;
+  }
+  memset(&boot_metrics.current, 0, sizeof(boot_metrics.current));
+}
+
+void boot_metrics_mark(boot_mark_t mark)
+{
+  if (boot_metrics.current.mark_us[mark] == 0) {
+    uint32_t const now = time_us_32();
+    boot_metrics.current.mark_us[mark] = now ? now : 1;
+  }
+}
+
+void boot_metrics_task(void)
+{
+  if (printed || boot_metrics.current.mark_us[BOOT_MARK_FIRST_INPUT] == 0) return;
+  printed = true;
+
+  boot_times_t const *current = &boot_metrics.current;
+  boot_times_t const *previous = &boot_metrics.previous;
+  LOG_INFO(BOOT, boot_metrics.boot_count);
+  LOG_INFO(BOOT_THIS, current->mark_us[BOOT_MARK_ENUMERATED], current->mark_us[BOOT_MARK_HANDSHAKE],
+           current->mark_us[BOOT_MARK_FIRST_INPUT]);
+  if (boot_metrics.boot_count) {
+    LOG_INFO(BOOT_LAST, previous->mark_us[BOOT_MARK_ENUMERATED], previous->mark_us[BOOT_MARK_HANDSHAKE],
+             previous->mark_us[BOOT_MARK_FIRST_INPUT]);
+  }
+}
@@ -0,0 +1,70 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _BOOT_METRICS_H_
+#define _BOOT_METRICS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Time from reset to the console seeing input.
+//
+// Each milestone is stamped once per boot in microseconds since reset. The
+// block lives in uninitialised RAM, so after a soft reset (watchdog, flash
+// save, debugger) the previous boot's times are still there to compare.
+
+#define BOOT_METRICS_MAGIC  0x544F4F42u   // "BOOT"
+
+typedef enum {
+  BOOT_MARK_ENUMERATED = 0,   // console set the configuration (tud_mount_cb)
+  BOOT_MARK_HANDSHAKE,        // 0x80 0x04 received, input reports allowed
+  BOOT_MARK_FIRST_INPUT,      // first 0x30 handed to the endpoint
+  BOOT_MARK_COUNT
+} boot_mark_t;
+
+typedef struct {
+  uint32_t mark_us[BOOT_MARK_COUNT];   // 0 = not reached
+} boot_times_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t boot_count;
+  boot_times_t current;
+  boot_times_t previous;
+} boot_metrics_t;
+
+extern boot_metrics_t boot_metrics;
+
+// Keep the previous boot's times and start a new record. Call first thing.
+void boot_metrics_init(void);
+
+// Stamp a milestone; only the first call per boot counts.
+void boot_metrics_mark(boot_mark_t mark);
+
+// Log both records once the first input went out, so the UART never
+// holds up the handshake.
+void boot_metrics_task(void);
+
+#endif /* _BOOT_METRICS_H_ */
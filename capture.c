@@ -0,0 +1,292 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "tusb.h"
+#include "pico/platform.h"
+#include "kbd_layout.h"
+#include "mouse_layout.h"
+#include "profile.h"
+#include "capture.h"
+
+_Static_assert(sizeof(kbd_layout_t) <= CAPTURE_DATA_MAX, "kbd_layout_t must fit in a mount record");
+_Static_assert(sizeof(mouse_layout_t) <= CAPTURE_DATA_MAX, "mouse_layout_t must fit in a mount record");
+
+#define RECORD_MASK  (CAPTURE_RECORDS - 1)
+
+static capture_record_t records[CAPTURE_RECORDS];
+static uint32_t head = 0;     // next record written
+static uint32_t count = 0;
+
+// what the window starts from, updated as records are evicted
+static capture_record_t base_mounts[CAPTURE_MAX_MOUNTS];
+static uint8_t base_mount_count = 0;
+static capture_record_t base_reports[CAPTURE_MAX_BASE_REPORTS];
+static uint8_t base_report_count = 0;
+static uint8_t base_profile = 0;
+static bool has_base_frame = false;
+static uint32_t base_frame_us = 0;
+
+static uint32_t period = 0;
+static uint32_t overwritten = 0;
+static uint32_t missed = 0;
+
+static struct {
+  bool active;
+  uint32_t offset;
+  uint32_t total;
+  capture_header_t header;
+} dump;
+
+void capture_init(uint32_t period_us, uint8_t profile)
+{
+  head = 0;
+  count = 0;
+  base_mount_count = 0;
+  base_report_count = 0;
+  base_profile = profile;
+  has_base_frame = false;
+  base_frame_us = 0;
+  period = period_us;
+  overwritten = 0;
+  missed = 0;
+  memset(&dump, 0, sizeof(dump));
+}
+
+// Drop the records of one device from a base table, keeping the order
+static uint8_t base_remove(capture_record_t *table, uint8_t n, uint8_t dev_addr, uint8_t instance)
+{
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    capture_record_t const *rec = &table[i];
+    if (rec->dev_addr == dev_addr && rec->instance == instance) continue;
+    if (kept != i) table[kept] = *rec;
+    kept++;
+  }
+  return kept;
+}
+
+static void base_umount(uint8_t dev_addr, uint8_t instance)
+{
+  base_mount_count = base_remove(base_mounts, base_mount_count, dev_addr, instance);
+  base_report_count = base_remove(base_reports, base_report_count, dev_addr, instance);
+}
+
+// Report ID of a report from a mounted device, 0 if none of its layouts use IDs
+static bool base_report_id(capture_record_t const *rec, uint8_t *id)
+{
+  bool mounted = false;
+  bool uses_id = false;
+  for (uint8_t i = 0; i < base_mount_count; i++) {
+    capture_record_t const *mount = &base_mounts[i];
+    if (mount->dev_addr != rec->dev_addr || mount->instance != rec->instance) continue;
+    mounted = true;
+    if (mount->protocol == HID_ITF_PROTOCOL_KEYBOARD) {
+      uses_id |= ((kbd_layout_t const *) mount->data)->uses_report_id;
+    } else if (mount->protocol == HID_ITF_PROTOCOL_MOUSE) {
+      uses_id |= ((mouse_layout_t const *) mount->data)->uses_report_id;
+    }
+  }
+  *id = (uses_id && rec->len) ? rec->data[0] : 0;
+  return mounted;
+}
+
+// Keep the newest report per device and report ID: every layout decodes the
+// full held state of its fields from one report, so the last one is enough.
+// Its motion is kept too; replay folds it into the base frame.
+static void base_report(capture_record_t const *rec)
+{
+  uint8_t id;
+  if (!base_report_id(rec, &id)) return;
+
+  uint8_t i = 0;
+  while (i < base_report_count && !(base_reports[i].dev_addr == rec->dev_addr &&
+                                    base_reports[i].instance == rec->instance &&
+                                    base_reports[i].protocol == id)) {
+    i++;
+  }
+  if (i == CAPTURE_MAX_BASE_REPORTS) return;
+  if (i == base_report_count) base_report_count++;
+  base_reports[i] = *rec;
+  base_reports[i].protocol = id;
+}
+
+static void base_mount(capture_record_t const *rec)
+{
+  uint8_t i = 0;
+  // a second mount of the same protocol replaces the layout, like input_mount()
+  while (i < base_mount_count && !(base_mounts[i].dev_addr == rec->dev_addr &&
+                                   base_mounts[i].instance == rec->instance &&
+                                   base_mounts[i].protocol == rec->protocol)) {
+    i++;
+  }
+  if (i == CAPTURE_MAX_MOUNTS) return;
+  if (i == base_mount_count) base_mount_count++;
+  base_mounts[i] = *rec;
+}
+
+// Fold a record leaving the window into the state the window starts from
+static void evict(capture_record_t const *rec)
+{
+  switch (rec->kind)
+  {
+    case CAPTURE_MOUNT:  base_mount(rec); break;
+    case CAPTURE_UMOUNT: base_umount(rec->dev_addr, rec->instance); break;
+    case CAPTURE_REPORT: base_report(rec); break;
+    case CAPTURE_FRAME:
+      base_profile = rec->instance;
+      // a refresh drains no motion, the last frame before it still counts
+      if (!rec->protocol) {
+        base_frame_us = rec->time_us;
+        has_base_frame = true;
+      }
+    break;
+    default: break;
+  }
+  overwritten++;
+}
+
+static capture_record_t *__not_in_flash_func(next_record)(void)
+{
+  if (dump.active) {
+    missed++;
+    return NULL;
+  }
+  capture_record_t *rec = &records[head];
+  if (count == CAPTURE_RECORDS) evict(rec);
+  else count++;
+  head = (head + 1) & RECORD_MASK;
+  return rec;
+}
+
+void __not_in_flash_func(capture_input)(uint8_t kind, uint32_t time_us, uint8_t dev_addr, uint8_t instance,
+                                        uint8_t protocol, uint8_t const *data, uint16_t len)
+{
+  capture_record_t *rec = next_record();
+  if (rec == NULL) return;
+
+  rec->time_us = time_us;
+  rec->kind = kind;
+  rec->dev_addr = dev_addr;
+  rec->instance = instance;
+  rec->protocol = protocol;
+  rec->truncated = len > CAPTURE_DATA_MAX;
+  if (rec->truncated) len = CAPTURE_DATA_MAX;
+  rec->len = (uint8_t) len;
+  memcpy(rec->data, data, len);
+}
+
+void __not_in_flash_func(capture_frame)(uint32_t time_us, uint8_t timer, uint8_t profile, bool refresh,
+                                        uint8_t const *report, uint16_t len)
+{
+  capture_record_t *rec = next_record();
+  if (rec == NULL) return;
+
+  uint32_t const crc = profile_crc32(report, len);
+  rec->time_us = time_us;
+  rec->kind = CAPTURE_FRAME;
+  rec->dev_addr = timer;
+  rec->instance = profile;
+  rec->protocol = refresh;
+  rec->truncated = 0;
+  rec->len = sizeof(crc);
+  memcpy(rec->data, &crc, sizeof(crc));
+}
+
+//--------------------------------------------------------------------+
+// Dump
+//--------------------------------------------------------------------+
+
+void capture_dump_begin(uint32_t ring_dropped)
+{
+  if (dump.active) return;
+
+  capture_header_t *h = &dump.header;
+  memset(h, 0, sizeof(*h));
+  h->magic = CAPTURE_MAGIC;
+  h->version = CAPTURE_VERSION;
+  h->record_size = sizeof(capture_record_t);
+  h->period_us = period;
+  h->base_frame_us = base_frame_us;
+  h->record_count = (uint16_t) count;
+  h->mount_count = base_mount_count;
+  h->report_count = base_report_count;
+  h->base_profile = base_profile;
+  h->flags = has_base_frame ? CAPTURE_HAS_BASE_FRAME : 0;
+  h->overwritten = overwritten;
+  h->missed = missed;
+  h->ring_dropped = ring_dropped;
+
+  dump.active = true;
+  dump.offset = 0;
+  dump.total = sizeof(*h) + (base_mount_count + base_report_count + count) * sizeof(capture_record_t);
+}
+
+bool capture_dumping(void)
+{
+  return dump.active;
+}
+
+uint32_t capture_dump_read(uint8_t *out, uint32_t max)
+{
+  uint32_t const mounts_end = sizeof(capture_header_t) + dump.header.mount_count * sizeof(capture_record_t);
+  uint32_t const reports_end = mounts_end + dump.header.report_count * sizeof(capture_record_t);
+  uint32_t const oldest = (head - count) & RECORD_MASK;
+  uint32_t n = 0;
+
+  while (dump.active && n < max) {
+    uint8_t const *src;
+    uint32_t avail;
+    uint32_t const off = dump.offset;
+    if (off < sizeof(capture_header_t)) {
+      src = (uint8_t const *) &dump.header + off;
+      avail = sizeof(capture_header_t) - off;
+    }
+    else if (off < mounts_end) {
+      uint32_t const rel = off - sizeof(capture_header_t);
+      src = (uint8_t const *) &base_mounts[rel / sizeof(capture_record_t)] + rel % sizeof(capture_record_t);
+      avail = sizeof(capture_record_t) - rel % sizeof(capture_record_t);
+    }
+    else if (off < reports_end) {
+      uint32_t const rel = off - mounts_end;
+      src = (uint8_t const *) &base_reports[rel / sizeof(capture_record_t)] + rel % sizeof(capture_record_t);
+      avail = sizeof(capture_record_t) - rel % sizeof(capture_record_t);
+    }
+    else {
+      uint32_t const rel = off - reports_end;
+      uint32_t const index = (oldest + rel / sizeof(capture_record_t)) & RECORD_MASK;
+      src = (uint8_t const *) &records[index] + rel % sizeof(capture_record_t);
+      avail = sizeof(capture_record_t) - rel % sizeof(capture_record_t);
+    }
+
+    uint32_t const chunk = avail < max - n ? avail : max - n;
+    memcpy(out + n, src, chunk);
+    n += chunk;
+    dump.offset += chunk;
+    if (dump.offset == dump.total) dump.active = false;
+  }
+  return n;
+}
@@ -0,0 +1,124 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Flight recorder of the host input stream.
+//
+// Every entry core0 takes off the hid_ring (mounts with their decoded
+// layouts, unmounts and raw reports with their core1 arrival time) is copied
+// into a fixed-size record, and every 0x30 report built gets a frame record
+// with its timer byte, profile and CRC. The ring keeps the newest
+// CAPTURE_RECORDS records; the cost per report is one memcpy, so it stays on
+// in production builds.
+//
+// Evicted mount records are folded into a small table of the devices that
+// were mounted when the oldest record was taken, and evicted reports into
+// the last report of each of those devices per report ID, which is what
+// their held keys and buttons follow from. A dump therefore holds
+// everything needed to replay it (host/replay.c).
+//
+// Dump format, little-endian as laid out in memory:
+//   capture_header_t
+//   capture_record_t[mount_count]    CAPTURE_MOUNT, devices mounted before the window
+//   capture_record_t[report_count]   CAPTURE_REPORT, their last report before it
+//   capture_record_t[record_count]   oldest first
+
+#ifndef CAPTURE_RECORDS
+#define CAPTURE_RECORDS     256
+#endif
+#define CAPTURE_DATA_MAX    52
+#define CAPTURE_MAX_MOUNTS  8
+#define CAPTURE_MAX_BASE_REPORTS  8
+#define CAPTURE_MAGIC       0x50414350u   // "PCAP"
+#define CAPTURE_VERSION     2           // 1: no base reports, report_count reads 0
+
+_Static_assert((CAPTURE_RECORDS & (CAPTURE_RECORDS - 1)) == 0, "CAPTURE_RECORDS must be a power of two");
+
+typedef enum {
+  CAPTURE_REPORT = 0,   // same values as hid_ring_kind_t
+  CAPTURE_MOUNT,
+  CAPTURE_UMOUNT,
+  CAPTURE_FRAME,        // a 0x30 report was built
+} capture_kind_t;
+
+typedef struct {
+  uint32_t time_us;     // report: arrival on core1, frame: now_us given to pro_report_build()
+  uint8_t  kind;        // capture_kind_t
+  uint8_t  dev_addr;    // frame: timer byte
+  uint8_t  instance;    // frame: active profile index
+  uint8_t  protocol;    // frame: 1 if it came from pro_report_refresh(), base report: report ID
+  uint8_t  len;         // bytes used in data
+  uint8_t  truncated;   // report was longer than CAPTURE_DATA_MAX
+  uint8_t  reserved[2];
+  uint8_t  data[CAPTURE_DATA_MAX];  // frame: profile_crc32() of the report
+} capture_record_t;
+
+_Static_assert(sizeof(capture_record_t) == 64, "capture records are 64 bytes");
+
+// flags
+#define CAPTURE_HAS_BASE_FRAME  0x01  // base_frame_us is the frame before the window
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t period_us;     // report period the frames were built with
+  uint32_t base_frame_us; // last frame before the oldest record
+  uint16_t record_count;
+  uint8_t  mount_count;
+  uint8_t  base_profile;  // profile active before the oldest record
+  uint8_t  flags;
+  uint8_t  report_count;  // last reports of the mounted devices before the oldest record
+  uint8_t  reserved[2];
+  uint32_t overwritten;   // records evicted by the ring wrapping
+  uint32_t missed;        // records not taken while a dump was running
+  uint32_t ring_dropped;  // reports core1 lost to a full hid_ring
+} capture_header_t;
+
+void capture_init(uint32_t period_us, uint8_t profile);
+
+// Record one hid_ring entry; data is the report or the decoded layout
+void capture_input(uint8_t kind, uint32_t time_us, uint8_t dev_addr, uint8_t instance,
+                   uint8_t protocol, uint8_t const *data, uint16_t len);
+
+// Record a built 0x30 report; refresh if it was built between frames
+void capture_frame(uint32_t time_us, uint8_t timer, uint8_t profile, bool refresh,
+                   uint8_t const *report, uint16_t len);
+
+// Freeze the ring and start a dump. Recording pauses until the last byte has
+// been read with capture_dump_read().
+void capture_dump_begin(uint32_t ring_dropped);
+bool capture_dumping(void);
+
+// Copy up to max bytes of the dump to out. Returns the number copied,
+// 0 once the dump is complete.
+uint32_t capture_dump_read(uint8_t *out, uint32_t max);
+
+#endif /* _CAPTURE_H_ */
@@ -0,0 +1,87 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _HID_ITEMS_H_
+#define _HID_ITEMS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Minimal HID report descriptor walker shared by the layout parsers.
+// Short item prefix: bTag[7:4] bType[3:2] bSize[1:0]; long items are skipped.
+
+#define HID_ITEM_TYPE_MAIN    0
+#define HID_ITEM_TYPE_GLOBAL  1
+#define HID_ITEM_TYPE_LOCAL   2
+
+#define HID_MAIN_INPUT            0x8
+#define HID_GLOBAL_USAGE_PAGE     0x0
+#define HID_GLOBAL_REPORT_SIZE    0x7
+#define HID_GLOBAL_REPORT_ID      0x8
+#define HID_GLOBAL_REPORT_COUNT   0x9
+#define HID_LOCAL_USAGE           0x0
+#define HID_LOCAL_USAGE_MIN       0x1
+#define HID_LOCAL_USAGE_MAX       0x2
+
+#define HID_INPUT_FLAG_CONSTANT   0x01
+#define HID_INPUT_FLAG_VARIABLE   0x02
+
+typedef struct {
+  uint8_t  type;
+  uint8_t  tag;
+  uint8_t  size;
+  uint32_t data;
+} hid_item_t;
+
+// Read the item at *pos and advance past it. Returns false at the end of
+// the descriptor or on a truncated item.
+static inline bool hid_item_next(uint8_t const *desc, uint16_t desc_len, uint16_t *pos, hid_item_t *item)
+{
+  while (*pos < desc_len) {
+    uint8_t const prefix = desc[(*pos)++];
+
+    if (prefix == 0xFE) {
+      if (*pos + 1 >= desc_len) return false;
+      *pos += 2 + desc[*pos];
+      continue;
+    }
+
+    uint8_t size = prefix & 0x03;
+    if (size == 3) size = 4;
+    if (*pos + size > desc_len) return false;
+
+    item->data = 0;
+    for (uint8_t i = 0; i < size; i++) item->data |= (uint32_t) desc[*pos + i] << (8 * i);
+    *pos += size;
+
+    item->type = (prefix >> 2) & 0x03;
+    item->tag  = prefix >> 4;
+    item->size = size;
+    return true;
+  }
+  return false;
+}
+
+#endif /* _HID_ITEMS_H_ */
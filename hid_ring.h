@@ -0,0 +1,111 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _HID_RING_H_
+#define _HID_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Single-producer / single-consumer ring used to hand raw host HID reports
+// from core1 (tuh_task) to core0 (decoding + report building).
+//
+// Only the producer ever writes head and only the consumer ever writes tail,
+// so the two cores never contend on a word. Indices run freely and are masked
+// on access, which is why the size must be a power of two.
+
+#define HID_RING_SIZE        32
+#define HID_RING_REPORT_MAX  64
+
+typedef enum {
+  HID_RING_REPORT = 0,  // data holds the raw input report
+  HID_RING_MOUNT,       // data holds a kbd_layout_t or mouse_layout_t, per protocol
+  HID_RING_UMOUNT,
+} hid_ring_kind_t;
+
+typedef struct {
+  uint64_t time_us;   // time_us_64() when the report reached core1
+  uint8_t  kind;      // hid_ring_kind_t
+  uint8_t  dev_addr;
+  uint8_t  instance;
+  uint8_t  protocol;  // hid_interface_protocol_enum_t
+  uint8_t  len;
+  uint8_t  data[HID_RING_REPORT_MAX];
+} hid_ring_entry_t;
+
+typedef struct {
+  _Atomic uint32_t head;    // next slot the producer fills
+  _Atomic uint32_t tail;    // next slot the consumer reads
+  uint32_t dropped;         // producer side: reports lost because the ring was full
+  hid_ring_entry_t entries[HID_RING_SIZE];
+} hid_ring_t;
+
+_Static_assert((HID_RING_SIZE & (HID_RING_SIZE - 1)) == 0, "HID_RING_SIZE must be a power of two");
+
+//--------------------------------------------------------------------+
+// Producer (core1)
+//--------------------------------------------------------------------+
+
+// Returns the slot to fill, or NULL when the ring is full.
+static inline hid_ring_entry_t *hid_ring_acquire(hid_ring_t *ring)
+{
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  if (head - tail >= HID_RING_SIZE) {
+    ring->dropped++;
+    return NULL;
+  }
+  return &ring->entries[head & (HID_RING_SIZE - 1)];
+}
+
+// Publishes the slot returned by hid_ring_acquire() to the consumer.
+static inline void hid_ring_commit(hid_ring_t *ring)
+{
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+//--------------------------------------------------------------------+
+// Consumer (core0)
+//--------------------------------------------------------------------+
+
+// Returns the oldest unread entry, or NULL when the ring is empty.
+// The entry stays valid until hid_ring_release() is called.
+static inline hid_ring_entry_t const *hid_ring_peek(hid_ring_t *ring)
+{
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  if (head == tail) return NULL;
+  return &ring->entries[tail & (HID_RING_SIZE - 1)];
+}
+
+static inline void hid_ring_release(hid_ring_t *ring)
+{
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+#endif /* _HID_RING_H_ */
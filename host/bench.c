@@ -0,0 +1,351 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+// Host microbenchmarks for the portable core.
+//
+// Feeds synthetic keyboard and mouse streams through the same code the
+// firmware runs on core0 and reports the cost per report of decoding,
+// mapping and packing, plus the protocol handlers, with the number of heap
+// allocations made while measuring (the firmware never allocates, so
+// anything but 0 is a regression).
+//
+//   picopro_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+#include "kbd_layout.h"
+#include "mouse_layout.h"
+#include "motion.h"
+#include "input.h"
+#include "profile.h"
+#include "report_queue.h"
+#include "switch_proto.h"
+#include "pro_report.h"
+#include "shim.h"
+
+//--------------------------------------------------------------------+
+// Allocation counting
+//--------------------------------------------------------------------+
+
+static unsigned long alloc_count = 0;
+
+#ifdef __GLIBC__
+// Interpose the allocator for the whole process and forward to glibc
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size)             { alloc_count++; return __libc_malloc(size); }
+void *calloc(size_t n, size_t size)   { alloc_count++; return __libc_calloc(n, size); }
+void *realloc(void *ptr, size_t size) { alloc_count++; return __libc_realloc(ptr, size); }
+void free(void *ptr)                  { __libc_free(ptr); }
+#endif
+
+//--------------------------------------------------------------------+
+// Synthetic devices
+//--------------------------------------------------------------------+
+
+#define STREAM_LEN   1024
+#define BATCH        64
+
+enum { DEV_BOOT_KBD = 1, DEV_NKRO_KBD, DEV_MOUSE };
+
+// NKRO keyboard, report ID 2: modifiers + bitmap of usages 0x00..0x77
+static const uint8_t nkro_desc[] = {
+  0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, 0x02, 0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7,
+  0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x19, 0x00, 0x29, 0x77,
+  0x95, 0x78, 0x81, 0x02, 0xC0
+};
+
+// Gaming mouse, report ID 1: 5 buttons, 16-bit X/Y, 8-bit wheel
+static const uint8_t mouse_desc[] = {
+  0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x85, 0x01, 0x09, 0x01, 0xA1, 0x00, 0x05, 0x09,
+  0x19, 0x01, 0x29, 0x05, 0x15, 0x00, 0x25, 0x01, 0x95, 0x05, 0x75, 0x01, 0x81, 0x02,
+  0x95, 0x01, 0x75, 0x03, 0x81, 0x01, 0x05, 0x01, 0x16, 0x01, 0x80, 0x26, 0xFF, 0x7F,
+  0x75, 0x10, 0x95, 0x02, 0x09, 0x30, 0x09, 0x31, 0x81, 0x06, 0x15, 0x81, 0x25, 0x7F,
+  0x75, 0x08, 0x95, 0x01, 0x09, 0x38, 0x81, 0x06, 0xC0, 0xC0
+};
+
+static uint8_t boot_stream[STREAM_LEN][8];
+static uint8_t nkro_stream[STREAM_LEN][17];
+static uint8_t mouse_stream[STREAM_LEN][7];
+
+static uint32_t rng_state = 0x2545F491u;
+
+static uint32_t rng(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+// Usages the profiles actually bind, so mapping does real work
+static const uint8_t hot_keys[] = {
+  HID_KEY_W, HID_KEY_A, HID_KEY_S, HID_KEY_D, HID_KEY_E, HID_KEY_R,
+  HID_KEY_Q, HID_KEY_SPACE, HID_KEY_X, HID_KEY_Y, HID_KEY_Z, HID_KEY_P,
+  HID_KEY_C
+};
+
+static void build_streams(void)
+{
+  for (int i = 0; i < STREAM_LEN; i++) {
+    uint8_t *b = boot_stream[i];
+    memset(b, 0, 8);
+    b[0] = (rng() & 1) ? 0x02 : 0x00;   // left shift now and then
+    int const held = rng() % 4;
+    for (int k = 0; k < held; k++) b[2 + k] = hot_keys[rng() % sizeof(hot_keys)];
+
+    uint8_t *n = nkro_stream[i];
+    memset(n, 0, 17);
+    n[0] = 2;
+    n[1] = b[0];
+    for (int k = 0; k < held + 4; k++) {
+      uint8_t const usage = (k < held) ? b[2 + k] : (uint8_t) (rng() % 0x78);
+      n[2 + usage / 8] |= 1u << (usage % 8);
+    }
+
+    uint8_t *m = mouse_stream[i];
+    int16_t const dx = (int16_t) (rng() % 64) - 32;
+    int16_t const dy = (int16_t) (rng() % 32) - 16;
+    m[0] = 1;
+    m[1] = (rng() % 8 == 0) ? 0x01 : 0x00;
+    m[2] = (uint16_t) dx & 0xFF;
+    m[3] = (uint16_t) dx >> 8;
+    m[4] = (uint16_t) dy & 0xFF;
+    m[5] = (uint16_t) dy >> 8;
+    m[6] = 0;
+  }
+}
+
+// The default bindings plus C on the walk tier, which the built-in
+// profiles leave unbound: once with the mouse on gyro, once on the stick
+#define KEYMAP_BIND(usage, action) [(usage)] = action,
+
+static struct {
+  profile_bank_header_t header;
+  profile_t profiles[2];
+} bench_bank = {
+  .header = {
+    .magic = PROFILE_MAGIC,
+    .version = PROFILE_VERSION,
+    .count = 2,
+    .tick_ms = PROFILE_TICK_MS,
+    .profile_size = sizeof(profile_t),
+  },
+  .profiles = {
+    {
+      .name = "bench",
+      .settings = PROFILE_SETTINGS_GYRO,
+      .keymap = {
+#include "profiles/default.def"
+        KEYMAP_BIND(HID_KEY_C, LSTICK_WALK)
+      },
+      .macros = MACRO_BANK_EMPTY,
+    },
+    {
+      .name = "bench stick",
+      .settings = PROFILE_SETTINGS_STICK,
+      .keymap = {
+#include "profiles/default.def"
+        KEYMAP_BIND(HID_KEY_C, LSTICK_WALK)
+      },
+      .macros = MACRO_BANK_EMPTY,
+    },
+  },
+};
+
+#undef KEYMAP_BIND
+
+static void load_profiles(void)
+{
+  bench_bank.header.crc32 = profile_crc32(bench_bank.profiles, sizeof(bench_bank.profiles));
+  if (!profile_bank_valid((profile_bank_t const *) &bench_bank, sizeof(bench_bank))) {
+    fprintf(stderr, "bench profile bank is not valid\n");
+    exit(1);
+  }
+  profile_init(&bench_bank);
+}
+
+static void mount_devices(void)
+{
+  kbd_layout_t kbd;
+  mouse_layout_t mouse;
+
+  kbd_layout_boot(&kbd);
+  input_mount(DEV_BOOT_KBD, 0, HID_ITF_PROTOCOL_KEYBOARD, &kbd);
+
+  if (!kbd_layout_parse(&kbd, nkro_desc, sizeof(nkro_desc))) {
+    fprintf(stderr, "NKRO descriptor did not parse\n");
+    exit(1);
+  }
+  input_mount(DEV_NKRO_KBD, 0, HID_ITF_PROTOCOL_KEYBOARD, &kbd);
+
+  if (!mouse_layout_parse(&mouse, mouse_desc, sizeof(mouse_desc))) {
+    fprintf(stderr, "mouse descriptor did not parse\n");
+    exit(1);
+  }
+  input_mount(DEV_MOUSE, 0, HID_ITF_PROTOCOL_MOUSE, &mouse);
+}
+
+//--------------------------------------------------------------------+
+// Benchmarks
+//--------------------------------------------------------------------+
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+// Virtual time of the synthetic stream, 8 kHz mouse
+static uint32_t stream_us = 0;
+
+static void bench_boot_decode(uint32_t i)
+{
+  input_report(DEV_BOOT_KBD, 0, stream_us, boot_stream[i % STREAM_LEN], 8);
+}
+
+static void bench_nkro_decode(uint32_t i)
+{
+  input_report(DEV_NKRO_KBD, 0, stream_us, nkro_stream[i % STREAM_LEN], 17);
+}
+
+static void bench_mouse_decode(uint32_t i)
+{
+  stream_us += 125;
+  input_report(DEV_MOUSE, 0, stream_us, mouse_stream[i % STREAM_LEN], 7);
+}
+
+static void bench_aggregate(uint32_t i)
+{
+  (void) i;
+  input_state_t state;
+  input_aggregate(&state);
+}
+
+static void bench_to_joystick(uint32_t i)
+{
+  uint8_t stick[3];
+  to_joystick(i & 0xFFF, (i >> 12) & 0xFFF, stick);
+}
+
+static void bench_pack(uint32_t i)
+{
+  stream_us += 125;
+  input_report(DEV_MOUSE, 0, stream_us, mouse_stream[i % STREAM_LEN], 7);
+  pro_report_build((uint8_t) i, stream_us, 30000);
+}
+
+static void bench_subcommand_ack(uint32_t i)
+{
+  uint8_t out[64] = { 0x01, (uint8_t) i };
+  out[10] = 0x30;   // player lights
+  switch_proto_output(out, sizeof(out), (uint8_t) i);
+}
+
+static void bench_spi_read(uint32_t i)
+{
+  // walk the calibration area, including unmapped pages
+  uint32_t const addr = 0x6000 + (i % 0x2100);
+  uint8_t out[64] = { 0x01, (uint8_t) i };
+  out[10] = 0x10;
+  out[11] = addr & 0xFF;
+  out[12] = (addr >> 8) & 0xFF;
+  out[15] = 0x18;
+  switch_proto_output(out, sizeof(out), (uint8_t) i);
+}
+
+typedef struct {
+  char const *name;
+  void (*run)(uint32_t i);
+  bool drain_motion;   // empty the motion timeline between batches, untimed
+} bench_t;
+
+static const bench_t benches[] = {
+  { "decode kbd boot",     bench_boot_decode,    false },
+  { "decode kbd nkro",     bench_nkro_decode,    false },
+  { "decode mouse 16-bit", bench_mouse_decode,   true  },
+  { "map aggregate",       bench_aggregate,      false },
+  { "pack to_joystick",    bench_to_joystick,    false },
+  { "pack 0x30 gyro",      bench_pack,           false },
+  { "proto subcmd ack",    bench_subcommand_ack, false },
+  { "proto spi read",      bench_spi_read,       false },
+};
+
+static void run_bench(bench_t const *bench, uint32_t iterations)
+{
+  uint64_t elapsed = 0;
+  unsigned long allocs = 0;
+
+  for (uint32_t done = 0; done < iterations; done += BATCH) {
+    unsigned long const allocs_before = alloc_count;
+    uint64_t const start = now_ns();
+    for (uint32_t i = done; i < done + BATCH; i++) bench->run(i);
+    elapsed += now_ns() - start;
+    allocs += alloc_count - allocs_before;
+
+    if (bench->drain_motion) {
+      int32_t dx, dy;
+      motion_velocity(stream_us, 30000, &dx, &dy);
+    }
+  }
+
+  uint32_t const count = (iterations + BATCH - 1) / BATCH * BATCH;
+  printf("%-22s %10lu %12.1f %8lu\n", bench->name, (unsigned long) count,
+         (double) elapsed / count, allocs);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t iterations = 1000000;
+  if (argc > 1) iterations = (uint32_t) strtoul(argv[1], NULL, 0);
+  if (iterations < BATCH) iterations = BATCH;
+
+  build_streams();
+  load_profiles();
+  switch_proto_init();
+  mount_devices();
+
+  printf("%-22s %10s %12s %8s\n", "benchmark", "reports", "ns/report", "allocs");
+  for (size_t b = 0; b < TU_ARRAY_SIZE(benches); b++) {
+    run_bench(&benches[b], iterations);
+  }
+
+  // same packing with the mouse on the right stick
+  profile_select(1);
+  static const bench_t stick = { "pack 0x30 stick", bench_pack, false };
+  run_bench(&stick, iterations);
+
+  printf("endpoint: %lu reports sent, %lu replies dropped\n",
+         (unsigned long) shim_endpoint.sent, (unsigned long) report_queue_stats.dropped_replies);
+  return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+// Console-side protocol simulator.
+//
+// Plays the Switch's half of the USB handshake against the portable
+// protocol core on a simulated 1 ms USB frame clock: the 0x80 0x01..0x04
+// USB commands, then the 0x01 subcommands a console sends while pairing,
+// including every SPI read. The IN endpoint is polled at its descriptor
+// interval and input reports are produced at the firmware's report period,
+// so replies compete with 0x30 reports the way they do on the wire.
+//
+// Prints the reply latency of every request, the frames the whole
+// handshake took and every request that went unanswered. Exits non-zero if
+// anything went unanswered.
+//
+//   picopro_console_sim [-i in_interval_ms] [-p report_period_ms] [-t timeout_ms]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tusb.h"
+#include "profile.h"
+#include "report_queue.h"
+#include "switch_proto.h"
+#include "pro_report.h"
+#include "shim.h"
+
+typedef struct {
+  char const *name;
+  uint8_t len;
+  uint8_t out[16];   // output report as the console sends it
+  bool    reply;     // false for commands the controller doesn't answer
+} request_t;
+
+#define USB_CMD(name, cmd, reply)  { name, 2, { 0x80, cmd }, reply }
+// 0x01 output report: packet counter, 8 bytes of rumble, subcommand, args
+#define SUBCMD(name, id, ...)      { name, 16, { 0x01, 0x00, 0x00, 0x01, 0x40, 0x40, 0x00, 0x01, 0x40, 0x40, id, __VA_ARGS__ }, true }
+#define SPI_READ(name, addr, size) SUBCMD(name, 0x10, (addr) & 0xFF, ((addr) >> 8) & 0xFF, 0x00, 0x00, size)
+
+// What a console sends after plugging in a Pro Controller over USB
+static const request_t script[] = {
+  USB_CMD("usb status",              0x01, true),
+  USB_CMD("usb handshake",           0x02, true),
+  USB_CMD("usb baud 3M",             0x03, true),
+  USB_CMD("usb handshake",           0x02, true),
+  USB_CMD("usb no timeout",          0x04, false),
+  SUBCMD("device info",              0x02, 0x00),
+  SUBCMD("shipment state",           0x08, 0x00),
+  SPI_READ("spi serial number",      0x6000, 0x10),
+  SUBCMD("input mode 0x30",          0x03, 0x30),
+  SUBCMD("trigger elapsed",          0x04, 0x00),
+  SPI_READ("spi colours",            0x6050, 0x0D),
+  SPI_READ("spi factory imu",        0x6020, 0x18),
+  SPI_READ("spi factory sensor",     0x6080, 0x18),
+  SPI_READ("spi factory stick 2",    0x6098, 0x12),
+  SPI_READ("spi user stick",         0x8010, 0x18),
+  SPI_READ("spi factory stick",      0x603D, 0x19),
+  SPI_READ("spi user imu",           0x8026, 0x1A),
+  SUBCMD("nfc/ir config",            0x21, 0x21, 0x00),
+  SUBCMD("enable imu",               0x40, 0x01),
+  SUBCMD("enable vibration",         0x48, 0x01),
+  SUBCMD("player lights",            0x30, 0x01),
+  SUBCMD("home light",               0x38, 0x01),
+};
+
+#define SCRIPT_LEN  (sizeof(script) / sizeof(script[0]))
+
+// Does an IN report answer this request?
+static bool is_reply(request_t const *req, uint8_t const *in, uint16_t len)
+{
+  if (req->out[0] == 0x80) return len >= 2 && in[0] == 0x81 && in[1] == req->out[1];
+  return len >= 15 && in[0] == 0x21 && in[14] == req->out[10];
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t in_interval = 8;     // bInterval of the HID IN endpoint
+  uint32_t report_period = 30;  // report_frame_task() period
+  uint32_t timeout = 100;       // frames before the console gives up on a reply
+
+  int opt;
+  while ((opt = getopt(argc, argv, "i:p:t:")) != -1) {
+    switch (opt) {
+      case 'i': in_interval = strtoul(optarg, NULL, 0); break;
+      case 'p': report_period = strtoul(optarg, NULL, 0); break;
+      case 't': timeout = strtoul(optarg, NULL, 0); break;
+      default:
+        fprintf(stderr, "usage: %s [-i in_interval_ms] [-p report_period_ms] [-t timeout_ms]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (in_interval == 0) in_interval = 1;
+  if (report_period == 0) report_period = 1;
+
+  shim_endpoint.manual = true;
+  profile_init(NULL);
+  switch_proto_init();
+
+  uint32_t frame = 0;
+  uint32_t unanswered = 0;
+  uint32_t inputs_seen = 0;
+  uint32_t worst = 0;
+
+  printf("%-22s %8s %8s\n", "request", "sent", "latency");
+  for (size_t r = 0; r < SCRIPT_LEN; r++) {
+    request_t const *req = &script[r];
+
+    // the console sends on the next frame; the device handles it in tud_task()
+    frame++;
+    uint32_t const sent = frame;
+    uint8_t out[64] = { 0 };
+    memcpy(out, req->out, req->len);
+    switch_proto_output(out, sizeof(out), (uint8_t) frame);
+
+    if (!req->reply) {
+      printf("%-22s %8lu %8s\n", req->name, (unsigned long) sent, "-");
+      continue;
+    }
+
+    bool answered = false;
+    while (!answered && frame - sent < timeout) {
+      frame++;
+
+      // report_frame_task(): a fresh 0x30 every report period once allowed
+      if (switch_proto_input_enabled() && frame % report_period == 0) {
+        report_queue_set_input(pro_report_build((uint8_t) frame, frame * 1000, report_period * 1000));
+        report_queue_kick();
+      }
+
+      if (frame % in_interval == 0) {
+        uint8_t in[64];
+        uint16_t len;
+        if (shim_endpoint_poll(in, &len)) {
+          if (in[0] == 0x30) inputs_seen++;
+          answered = is_reply(req, in, len);
+        }
+      }
+    }
+
+    if (answered) {
+      uint32_t const latency = frame - sent;
+      if (latency > worst) worst = latency;
+      printf("%-22s %8lu %6lu ms\n", req->name, (unsigned long) sent, (unsigned long) latency);
+    }
+    else {
+      unanswered++;
+      printf("%-22s %8lu %8s\n", req->name, (unsigned long) sent, "NO REPLY");
+    }
+  }
+
+  printf("\nhandshake: %lu frames (%lu ms), worst reply %lu ms, %lu input reports interleaved\n",
+         (unsigned long) frame, (unsigned long) frame, (unsigned long) worst, (unsigned long) inputs_seen);
+  printf("replies dropped by the queue: %lu, unanswered requests: %lu\n",
+         (unsigned long) report_queue_stats.dropped_replies, (unsigned long) unanswered);
+  return unanswered ? 1 : 0;
+}
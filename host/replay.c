@@ -0,0 +1,221 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+// Deterministic replay of an input capture.
+//
+// Reads a capture dump (capture.h), as saved from the UART, and feeds it
+// through the portable core in recorded order: the devices mounted before
+// the window, then every mount, unmount and report with its original
+// arrival time, building a 0x30 report at every recorded frame with the
+// recorded timer byte and time. Each report is printed as hex (or written
+// raw with -o) and checked against the CRC the firmware recorded. A capture
+// that wrapped also carries each device's last report before the window, so
+// keys and buttons held across its start are held in the replay too.
+//
+// Anything before the dump's magic is skipped, so a UART log with text in
+// front of the dump can be given as is. Profile uploads are not captured;
+// pass the uploaded bank with -b if the firmware was running one.
+//
+// The first frame of a capture that wrapped can differ: only the last of the
+// evicted reports is kept, so motion from the others is missing. So can
+// refreshes recorded before it, which repeat its right stick. Exits non-zero
+// if any later report differs.
+//
+//   picopro_replay [-b profile_bank.bin] [-o reports.bin] [-q] capture.bin
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tusb.h"
+#include "motion.h"
+#include "input.h"
+#include "profile.h"
+#include "pro_report.h"
+#include "capture.h"
+
+static uint8_t *read_file(char const *path, size_t *len)
+{
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) return NULL;
+
+  size_t cap = 1 << 16, n = 0;
+  uint8_t *buf = malloc(cap);
+  size_t got;
+  while (buf && (got = fread(buf + n, 1, cap - n, f)) > 0) {
+    n += got;
+    if (n == cap) buf = realloc(buf, cap *= 2);
+  }
+  fclose(f);
+  *len = n;
+  return buf;
+}
+
+static void replay_input(capture_record_t const *rec)
+{
+  switch (rec->kind)
+  {
+    case CAPTURE_MOUNT:
+      input_mount(rec->dev_addr, rec->instance, rec->protocol, rec->data);
+    break;
+
+    case CAPTURE_UMOUNT:
+      input_umount(rec->dev_addr, rec->instance);
+    break;
+
+    case CAPTURE_REPORT:
+      input_report(rec->dev_addr, rec->instance, rec->time_us, rec->data, rec->len);
+    break;
+
+    default: break;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  char const *bank_path = NULL;
+  char const *out_path = NULL;
+  bool quiet = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "b:o:q")) != -1) {
+    switch (opt) {
+      case 'b': bank_path = optarg; break;
+      case 'o': out_path = optarg; break;
+      case 'q': quiet = true; break;
+      default: optind = argc + 1; break;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "usage: %s [-b profile_bank.bin] [-o reports.bin] [-q] capture.bin\n", argv[0]);
+    return 2;
+  }
+
+  size_t len;
+  uint8_t *file = read_file(argv[optind], &len);
+  if (file == NULL) {
+    perror(argv[optind]);
+    return 2;
+  }
+
+  // find the dump inside whatever else the UART carried
+  uint32_t const magic = CAPTURE_MAGIC;
+  size_t start = 0;
+  while (start + sizeof(capture_header_t) <= len && memcmp(file + start, &magic, sizeof(magic)) != 0) start++;
+
+  capture_header_t header;
+  if (start + sizeof(header) > len) {
+    fprintf(stderr, "%s: no capture found\n", argv[optind]);
+    return 2;
+  }
+  memcpy(&header, file + start, sizeof(header));
+  // version 1 dumps have no base reports, their report_count reads 0
+  uint32_t const base = header.mount_count + header.report_count;
+  uint32_t const total = base + header.record_count;
+  if ((header.version != CAPTURE_VERSION && header.version != 1) || header.record_size != sizeof(capture_record_t) ||
+      start + sizeof(header) + (size_t) total * sizeof(capture_record_t) > len) {
+    fprintf(stderr, "%s: unsupported or truncated capture (version %u)\n", argv[optind], header.version);
+    return 2;
+  }
+
+  void *bank = NULL;
+  if (bank_path) {
+    size_t bank_len;
+    bank = read_file(bank_path, &bank_len);
+    if (bank == NULL || bank_len < PROFILE_FLASH_SIZE || !profile_bank_valid(bank, PROFILE_FLASH_SIZE)) {
+      fprintf(stderr, "%s: not a valid profile bank\n", bank_path);
+      return 2;
+    }
+  }
+
+  FILE *out = NULL;
+  if (out_path && (out = fopen(out_path, "wb")) == NULL) {
+    perror(out_path);
+    return 2;
+  }
+
+  // rebuild the state the window starts from: devices, what they last
+  // reported, and the base frame, which takes any motion in those reports
+  profile_init(bank);
+  profile_select(header.base_profile);
+  uint8_t const *p = file + start + sizeof(header);
+  for (uint32_t i = 0; i < base; i++, p += sizeof(capture_record_t)) {
+    capture_record_t rec;
+    memcpy(&rec, p, sizeof(rec));
+    replay_input(&rec);
+  }
+  if (header.flags & CAPTURE_HAS_BASE_FRAME) {
+    int32_t dx, dy;
+    motion_velocity(header.base_frame_us, header.period_us, &dx, &dy);
+  }
+
+  uint32_t frames = 0, reports = 0, mismatches = 0, late_mismatches = 0, truncated = 0;
+  // motion from before the window is missing until the first full frame,
+  // and refreshes before it repeat a right stick the replay never built
+  bool first_built = false;
+  for (uint32_t i = 0; i < header.record_count; i++, p += sizeof(capture_record_t)) {
+    capture_record_t rec;
+    memcpy(&rec, p, sizeof(rec));
+    truncated += rec.truncated;
+
+    if (rec.kind != CAPTURE_FRAME) {
+      if (rec.kind == CAPTURE_REPORT) reports++;
+      replay_input(&rec);
+      continue;
+    }
+
+    uint8_t const *report = rec.protocol ? pro_report_refresh(rec.dev_addr)
+                                         : pro_report_build(rec.dev_addr, rec.time_us, header.period_us);
+
+    uint32_t crc;
+    memcpy(&crc, rec.data, sizeof(crc));
+    bool const match = profile_crc32(report, PRO_REPORT_SIZE) == crc;
+    if (!match) {
+      mismatches++;
+      if (first_built) late_mismatches++;
+    }
+    frames++;
+    if (!rec.protocol) first_built = true;
+
+    if (out) fwrite(report, 1, PRO_REPORT_SIZE, out);
+    if (!quiet) {
+      printf("%10lu %02x%c", (unsigned long) rec.time_us, rec.dev_addr, match ? ' ' : '!');
+      for (uint8_t b = 0; b < PRO_REPORT_SIZE; b++) printf("%02x", report[b]);
+      printf("\n");
+    }
+  }
+  if (out) fclose(out);
+
+  fprintf(stderr, "%lu mounted, %lu reports, %lu frames, %lu mismatched (%lu after the first)\n",
+          (unsigned long) header.mount_count, (unsigned long) reports, (unsigned long) frames,
+          (unsigned long) mismatches, (unsigned long) late_mismatches);
+  fprintf(stderr, "records overwritten %lu, missed during dump %lu, truncated %lu, dropped by hid_ring %lu\n",
+          (unsigned long) header.overwritten, (unsigned long) header.missed,
+          (unsigned long) truncated, (unsigned long) header.ring_dropped);
+  free(file);
+  free(bank);
+  return late_mismatches ? 1 : 0;
+}
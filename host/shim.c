@@ -0,0 +1,72 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+#include "pico/time.h"
+#include "shim.h"
+
+shim_endpoint_t shim_endpoint;
+
+uint64_t time_us_64(void)
+{
+  static uint64_t start_ns = 0;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t const now_ns = (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+  if (start_ns == 0) start_ns = now_ns;
+  return (now_ns - start_ns) / 1000u;
+}
+
+bool tud_hid_ready(void)
+{
+  return !shim_endpoint.busy;
+}
+
+// Without manual mode this completes immediately: the report is recorded
+// and the next one may go
+bool tud_hid_report(uint8_t report_id, void const *report, uint16_t len)
+{
+  (void) report_id;
+  if (shim_endpoint.busy) return false;
+  if (len > sizeof(shim_endpoint.last)) len = sizeof(shim_endpoint.last);
+  memcpy(shim_endpoint.last, report, len);
+  shim_endpoint.last_len = len;
+  shim_endpoint.sent++;
+  shim_endpoint.busy = shim_endpoint.manual;
+  return true;
+}
+
+bool shim_endpoint_poll(uint8_t *report, uint16_t *len)
+{
+  if (!shim_endpoint.busy) return false;
+  memcpy(report, shim_endpoint.last, shim_endpoint.last_len);
+  *len = shim_endpoint.last_len;
+  shim_endpoint.busy = false;
+  tud_hid_report_complete_cb(0, report, *len);
+  return true;
+}
@@ -0,0 +1,51 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _HOST_SHIM_H_
+#define _HOST_SHIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// What the shimmed device endpoint has seen.
+//
+// By default a report completes as soon as it is handed over. With manual
+// set, it stays in flight (tud_hid_ready() false) until the simulated host
+// collects it with shim_endpoint_poll(), like a real IN endpoint.
+typedef struct {
+  uint32_t sent;
+  uint16_t last_len;
+  uint8_t  last[64];
+  bool     manual;
+  bool     busy;
+} shim_endpoint_t;
+
+extern shim_endpoint_t shim_endpoint;
+
+// IN token from the host: copies out the report in flight, if any, and
+// runs tud_hid_report_complete_cb() the way the device stack would.
+bool shim_endpoint_poll(uint8_t *report, uint16_t *len);
+
+#endif /* _HOST_SHIM_H_ */
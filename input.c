@@ -0,0 +1,160 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "tusb.h"
+#include "pico/platform.h"
+#include "keymap.h"
+#include "profile.h"
+#include "motion.h"
+#include "input.h"
+
+_Static_assert(INPUT_MAX_DEVICES >= CFG_TUH_HID, "one input slot per host HID interface");
+
+// Mouse buttons sit at KEYMAP_MOUSE_BASE in the held bitmap
+#define MOUSE_HELD_WORD   (KEYMAP_MOUSE_BASE >> 5)
+#define MOUSE_HELD_SHIFT  (KEYMAP_MOUSE_BASE & 31)
+
+static input_device_t devices[INPUT_MAX_DEVICES];
+
+static input_device_t *__not_in_flash_func(find_device)(uint8_t dev_addr, uint8_t instance)
+{
+  for (uint8_t i = 0; i < INPUT_MAX_DEVICES; i++) {
+    if (devices[i].in_use && devices[i].dev_addr == dev_addr && devices[i].instance == instance) {
+      return &devices[i];
+    }
+  }
+  return NULL;
+}
+
+bool input_mount(uint8_t dev_addr, uint8_t instance, uint8_t protocol, void const *layout)
+{
+  input_device_t *dev = find_device(dev_addr, instance);
+  for (uint8_t i = 0; i < INPUT_MAX_DEVICES && dev == NULL; i++) {
+    if (!devices[i].in_use) {
+      dev = &devices[i];
+      memset(dev, 0, sizeof(*dev));
+      dev->in_use = true;
+      dev->dev_addr = dev_addr;
+      dev->instance = instance;
+    }
+  }
+  if (dev == NULL) return false;
+
+  if (protocol == HID_ITF_PROTOCOL_KEYBOARD) {
+    dev->has_kbd = true;
+    if (layout) dev->kbd = *(kbd_layout_t const *) layout;
+    else kbd_layout_boot(&dev->kbd);
+  } else if (protocol == HID_ITF_PROTOCOL_MOUSE) {
+    dev->has_mouse = true;
+    if (layout) dev->mouse = *(mouse_layout_t const *) layout;
+    else mouse_layout_boot(&dev->mouse);
+  }
+  return true;
+}
+
+void input_umount(uint8_t dev_addr, uint8_t instance)
+{
+  input_device_t *dev = find_device(dev_addr, instance);
+  if (dev) memset(dev, 0, sizeof(*dev));
+}
+
+static uint8_t __not_in_flash_func(process_kbd_report)(input_device_t *dev, uint8_t const *report, uint16_t len)
+{
+  uint32_t keys[KEY_BITMAP_WORDS];
+  memcpy(keys, dev->held, sizeof(keys));
+  if (!kbd_layout_decode(&dev->kbd, report, len, keys)) return 0;
+
+  // one XOR per 32 keys finds every press and release, modifiers included
+  uint32_t changed = 0;
+  for (uint8_t w = 0; w < KEY_BITMAP_WORDS; w++) {
+    changed |= keys[w] ^ dev->held[w];
+    dev->held[w] = keys[w];
+  }
+  return changed ? INPUT_CHANGED_HELD : 0;
+}
+
+static uint8_t __not_in_flash_func(process_mouse_report)(input_device_t *dev, uint32_t time_us, uint8_t const *report, uint16_t len)
+{
+  uint8_t buttons;
+  int32_t dx, dy;
+  if (!mouse_layout_decode(&dev->mouse, report, len, &buttons, &dx, &dy)) return 0;
+
+  uint32_t held = dev->held[MOUSE_HELD_WORD];
+  uint32_t mouse = (uint32_t) buttons << MOUSE_HELD_SHIFT;
+  dev->held[MOUSE_HELD_WORD] = (held & ~(0xFFu << MOUSE_HELD_SHIFT)) | mouse;
+
+  //x is inverted
+  if (dx || dy) motion_add(time_us, -dx, dy);
+
+  return ((held ^ dev->held[MOUSE_HELD_WORD]) ? INPUT_CHANGED_HELD : 0) |
+         ((dx || dy) ? INPUT_CHANGED_MOTION : 0);
+}
+
+uint8_t __not_in_flash_func(input_report)(uint8_t dev_addr, uint8_t instance, uint32_t time_us, uint8_t const *report, uint16_t len)
+{
+  input_device_t *dev = find_device(dev_addr, instance);
+  if (dev == NULL) return 0;
+
+  // with report IDs one interface can carry both; each decoder ignores
+  // reports that aren't its own
+  if (dev->has_kbd) {
+    uint8_t const changed = process_kbd_report(dev, report, len);
+    if (changed) return changed;
+  }
+  if (dev->has_mouse) return process_mouse_report(dev, time_us, report, len);
+  return 0;
+}
+
+void __not_in_flash_func(input_aggregate)(input_state_t *state)
+{
+  uint32_t held[KEY_BITMAP_WORDS] = { 0 };
+
+  for (uint8_t i = 0; i < INPUT_MAX_DEVICES; i++) {
+    input_device_t *dev = &devices[i];
+    if (!dev->in_use) continue;
+    for (uint8_t w = 0; w < KEY_BITMAP_WORDS; w++) held[w] |= dev->held[w];
+  }
+
+  // profile switches and uploads land here, between two reports
+  profile_apply_pending();
+  profile_check_chord(held);
+
+  // the state is rebuilt from what is held right now, so a button bound to
+  // two inputs stays down until both are released and nothing can stick
+  memset(state, 0, sizeof(*state));
+  for (uint8_t w = 0; w < KEY_BITMAP_WORDS; w++) {
+    uint32_t bits = held[w];
+    while (bits) {
+      uint8_t bit = __builtin_ctz(bits);
+      bits &= bits - 1;
+      keymap_entry_t entry = keymap_lookup((w << 5) | bit);
+      state->buttons[entry.byte] |= entry.mask;
+      if (entry.stick != STICK_NONE) state->stick_dirs |= STICK_DIR_BIT(entry.stick);
+      if (entry.macro) state->macros |= 1u << (entry.macro - 1);
+    }
+  }
+}
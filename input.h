@@ -0,0 +1,85 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _INPUT_H_
+#define _INPUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "kbd_layout.h"
+#include "mouse_layout.h"
+
+// Host input devices and the controller state they add up to.
+//
+// Every mounted keyboard / mouse interface gets its own slot keyed by
+// (dev_addr, instance) with its own held-input bitmap, so devices behind the
+// hub never disturb each other's edge detection. An interface may carry both
+// a keyboard and a mouse report. input_aggregate() merges all slots into one
+// controller state by OR-ing the held inputs; mouse motion goes straight to
+// the motion timeline (motion.h) with the report's arrival time.
+
+#define INPUT_MAX_DEVICES  4
+
+// What input_report() saw change
+#define INPUT_CHANGED_HELD    0x01  // a key or mouse button went down or up
+#define INPUT_CHANGED_MOTION  0x02  // the mouse moved
+
+// Bit for a stick_action_t in input_state_t.stick_dirs
+#define STICK_DIR_BIT(dir) (1u << (dir))
+
+typedef struct {
+  bool     in_use;
+  uint8_t  dev_addr;
+  uint8_t  instance;
+  bool     has_kbd;
+  bool     has_mouse;
+  uint32_t held[KEY_BITMAP_WORDS];    // held inputs by usage, see keymap.h
+  kbd_layout_t   kbd;
+  mouse_layout_t mouse;
+} input_device_t;
+
+typedef struct {
+  uint8_t buttons[3];   // button block, byte 3 of the final report is buttons[0]
+  uint8_t stick_dirs;   // STICK_DIR_BIT() of every held left stick direction
+  uint8_t macros;       // bit n: an input bound to macro n is held
+} input_state_t;
+
+// Allocate a slot for a newly mounted interface, or add a layout to it.
+// layout is a kbd_layout_t for HID_ITF_PROTOCOL_KEYBOARD and a mouse_layout_t
+// for HID_ITF_PROTOCOL_MOUSE. Returns false when every slot is taken.
+bool input_mount(uint8_t dev_addr, uint8_t instance, uint8_t protocol, void const *layout);
+
+// Free the slot; whatever the device was holding is released.
+void input_umount(uint8_t dev_addr, uint8_t instance);
+
+// Fold one raw report, received at time_us, into its device slot.
+// Returns the INPUT_CHANGED_* flags, 0 if nothing changed.
+uint8_t input_report(uint8_t dev_addr, uint8_t instance, uint32_t time_us, uint8_t const *report, uint16_t len);
+
+// Merge all devices into one controller state.
+void input_aggregate(input_state_t *state);
+
+#endif /* _INPUT_H_ */
@@ -0,0 +1,200 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "pico/platform.h"
+#include "hid_items.h"
+#include "kbd_layout.h"
+
+#define USAGE_PAGE_KEYBOARD 0x07
+
+// Keyboard page usages 0x01-0x03 are rollover/error codes, not keys
+#define FIRST_KEY_USAGE     0x04
+
+#define MAX_REPORT_IDS      8
+
+static inline void key_bitmap_set(uint32_t *keys, uint8_t usage)
+{
+  keys[usage >> 5] |= 1u << (usage & 31);
+}
+
+static void __not_in_flash_func(key_bitmap_clear_range)(uint32_t *keys, uint8_t lo, uint8_t hi)
+{
+  for (unsigned w = lo >> 5; w <= (unsigned) (hi >> 5); w++) {
+    uint32_t mask = 0xFFFFFFFFu;
+    if (w == (unsigned) (lo >> 5)) mask &= 0xFFFFFFFFu << (lo & 31);
+    if (w == (unsigned) (hi >> 5)) mask &= 0xFFFFFFFFu >> (31 - (hi & 31));
+    keys[w] &= ~mask;
+  }
+}
+
+void kbd_layout_boot(kbd_layout_t *layout)
+{
+  memset(layout, 0, sizeof(*layout));
+  layout->field_count = 2;
+  // modifier byte
+  layout->fields[0] = (kbd_field_t) { .bit_offset = 0, .is_array = 0, .usage_min = 0xE0, .usage_max = 0xE7, .count = 8 };
+  // reserved byte, then 6 keycode slots
+  layout->fields[1] = (kbd_field_t) { .bit_offset = 16, .is_array = 1, .usage_min = 0x00, .usage_max = 0xFF, .count = 6 };
+}
+
+bool kbd_layout_parse(kbd_layout_t *layout, uint8_t const *desc, uint16_t desc_len)
+{
+  memset(layout, 0, sizeof(*layout));
+  if (desc == NULL) return false;
+
+  // running input bit offset for each report ID seen so far
+  struct { uint8_t id; uint16_t bits; } offsets[MAX_REPORT_IDS] = { { 0, 0 } };
+  uint8_t offset_count = 1;
+  uint8_t current = 0;
+
+  uint16_t usage_page = 0;
+  uint32_t report_size = 0;
+  uint32_t report_count = 0;
+  uint32_t usage = 0, usage_min = 0, usage_max = 0;
+  bool has_usage = false, has_min = false, has_max = false;
+
+  uint16_t pos = 0;
+  hid_item_t item;
+  while (hid_item_next(desc, desc_len, &pos, &item)) {
+    uint32_t const data = item.data;
+    uint8_t const tag = item.tag;
+
+    if (item.type == HID_ITEM_TYPE_GLOBAL) {
+      switch (tag) {
+        case HID_GLOBAL_USAGE_PAGE:   usage_page = (uint16_t) data; break;
+        case HID_GLOBAL_REPORT_SIZE:  report_size = data; break;
+        case HID_GLOBAL_REPORT_COUNT: report_count = data; break;
+        case HID_GLOBAL_REPORT_ID: {
+          layout->uses_report_id = 1;
+          uint8_t i;
+          for (i = 0; i < offset_count; i++) {
+            if (offsets[i].id == (uint8_t) data) break;
+          }
+          if (i == offset_count) {
+            if (offset_count == MAX_REPORT_IDS) return layout->field_count > 0;
+            offsets[offset_count].id = (uint8_t) data;
+            offsets[offset_count].bits = 0;
+            offset_count++;
+          }
+          current = i;
+        } break;
+        default: break;
+      }
+    }
+    else if (item.type == HID_ITEM_TYPE_LOCAL) {
+      switch (tag) {
+        case HID_LOCAL_USAGE:     if (!has_usage) { usage = data & 0xFFFF; has_usage = true; } break;
+        case HID_LOCAL_USAGE_MIN: usage_min = data & 0xFFFF; has_min = true; break;
+        case HID_LOCAL_USAGE_MAX: usage_max = data & 0xFFFF; has_max = true; break;
+        default: break;
+      }
+    }
+    else if (item.type == HID_ITEM_TYPE_MAIN) {
+      if (tag == HID_MAIN_INPUT) {
+        uint32_t bits = report_size * report_count;
+        bool constant = data & HID_INPUT_FLAG_CONSTANT;
+        bool variable = data & HID_INPUT_FLAG_VARIABLE;
+
+        if (usage_page == USAGE_PAGE_KEYBOARD && !constant && layout->field_count < KBD_LAYOUT_MAX_FIELDS) {
+          uint32_t first = has_min ? usage_min : (has_usage ? usage : 0);
+          kbd_field_t field = {
+            .bit_offset = offsets[current].bits,
+            .report_id  = offsets[current].id,
+            .usage_min  = first > 0xFF ? 0xFF : (uint8_t) first,
+          };
+
+          if (variable && report_size == 1) {
+            uint32_t count = report_count;
+            if (field.usage_min + count > 256) count = 256 - field.usage_min;
+            field.is_array  = 0;
+            field.count     = count > 0xFF ? 0xFF : (uint8_t) count;
+            field.usage_max = (uint8_t) (field.usage_min + field.count - 1);
+            if (field.count) layout->fields[layout->field_count++] = field;
+          }
+          else if (!variable && report_size == 8 && (field.bit_offset & 7) == 0) {
+            uint32_t last = has_max ? usage_max : 0xFF;
+            field.is_array  = 1;
+            field.count     = report_count > 0xFF ? 0xFF : (uint8_t) report_count;
+            field.usage_max = last > 0xFF ? 0xFF : (uint8_t) last;
+            if (field.count) layout->fields[layout->field_count++] = field;
+          }
+        }
+        offsets[current].bits += (uint16_t) bits;
+      }
+      // locals only apply to the main item they precede
+      has_usage = has_min = has_max = false;
+      usage = usage_min = usage_max = 0;
+    }
+  }
+
+  return layout->field_count > 0;
+}
+
+bool __not_in_flash_func(kbd_layout_decode)(kbd_layout_t const *layout, uint8_t const *report, uint16_t len, uint32_t keys[KEY_BITMAP_WORDS])
+{
+  uint8_t report_id = 0;
+  if (layout->uses_report_id) {
+    if (len == 0) return false;
+    report_id = report[0];
+    report++;
+    len--;
+  }
+
+  bool found = false;
+  for (uint8_t f = 0; f < layout->field_count; f++) {
+    kbd_field_t const *field = &layout->fields[f];
+    if (field->report_id != report_id) continue;
+    found = true;
+
+    key_bitmap_clear_range(keys, field->usage_min, field->usage_max);
+
+    if (field->is_array) {
+      uint16_t first = field->bit_offset >> 3;
+      uint8_t span = field->usage_max - field->usage_min;
+      for (uint8_t i = 0; i < field->count && first + i < len; i++) {
+        uint8_t value = report[first + i];
+        if (value > span) continue;
+        uint8_t usage = field->usage_min + value;
+        if (usage >= FIRST_KEY_USAGE) key_bitmap_set(keys, usage);
+      }
+    }
+    else {
+      for (uint16_t i = 0; i < field->count; i++) {
+        uint16_t bit = field->bit_offset + i;
+        uint16_t byte = bit >> 3;
+        if (byte >= len) break;
+        // whole idle bytes are the common case on NKRO bitmaps
+        if ((bit & 7) == 0 && report[byte] == 0) {
+          i += 7;
+          continue;
+        }
+        if (report[byte] & (1u << (bit & 7))) key_bitmap_set(keys, field->usage_min + i);
+      }
+    }
+  }
+  return found;
+}
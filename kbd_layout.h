@@ -0,0 +1,73 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _KBD_LAYOUT_H_
+#define _KBD_LAYOUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Where a keyboard puts its keys inside an input report.
+//
+// Boot keyboards use the fixed 8-byte layout, but report-protocol and NKRO
+// keyboards describe theirs in the report descriptor: usually a modifier
+// bitmap, then either a 6-slot keycode array or a bitmap with one bit per
+// key. kbd_layout_parse() records those fields, and kbd_layout_decode() turns
+// any report into a 256-bit key state indexed by keyboard usage (modifiers
+// land on 0xE0-0xE7, matching keymap.h).
+
+#define KBD_LAYOUT_MAX_FIELDS  6
+#define KEY_BITMAP_WORDS       (256 / 32)
+
+typedef struct {
+  uint16_t bit_offset;  // from the first byte after the report ID
+  uint8_t  report_id;   // 0 if the device doesn't use report IDs
+  uint8_t  is_array;    // 1: count 8-bit keycode slots, 0: count 1-bit keys
+  uint8_t  usage_min;
+  uint8_t  usage_max;
+  uint8_t  count;
+  uint8_t  reserved;
+} kbd_field_t;
+
+typedef struct {
+  uint8_t field_count;
+  uint8_t uses_report_id;
+  uint8_t reserved[2];
+  kbd_field_t fields[KBD_LAYOUT_MAX_FIELDS];
+} kbd_layout_t;
+
+// Layout of the 8-byte boot keyboard report
+void kbd_layout_boot(kbd_layout_t *layout);
+
+// Collect the keyboard page input fields from a report descriptor.
+// Returns false if the descriptor has no usable keyboard fields.
+bool kbd_layout_parse(kbd_layout_t *layout, uint8_t const *desc, uint16_t desc_len);
+
+// Update keys[] with the fields carried by this report. Keys covered by
+// other report IDs keep their previous state.
+// Returns false if the report carries no keyboard fields.
+bool kbd_layout_decode(kbd_layout_t const *layout, uint8_t const *report, uint16_t len, uint32_t keys[KEY_BITMAP_WORDS]);
+
+#endif /* _KBD_LAYOUT_H_ */
@@ -0,0 +1,117 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _KEYMAP_H_
+#define _KEYMAP_H_
+
+#include <stdint.h>
+
+// Keycode -> Pro Controller button lookup.
+//
+// Every host input is a HID usage in 0x00-0xFF: keyboard keys use their
+// keyboard page usage, the 8 modifier bits are usages 0xE0-0xE7 (exactly as
+// in the keyboard page) and mouse buttons are placed in the reserved range
+// starting at KEYMAP_MOUSE_BASE. Resolving any input is one table load.
+
+#define KEYMAP_SIZE         256
+#define KEYMAP_MODIFIER_BASE  0xE0
+#define KEYMAP_MOUSE_BASE     0xF0
+
+#define KEYMAP_MODIFIER(bit)     (KEYMAP_MODIFIER_BASE + (bit))
+#define KEYMAP_MOUSE_BUTTON(bit) (KEYMAP_MOUSE_BASE + (bit))
+
+#define KEYMAP_MOUSE_LEFT     KEYMAP_MOUSE_BUTTON(0)
+#define KEYMAP_MOUSE_RIGHT    KEYMAP_MOUSE_BUTTON(1)
+#define KEYMAP_MOUSE_MIDDLE   KEYMAP_MOUSE_BUTTON(2)
+#define KEYMAP_MOUSE_BACKWARD KEYMAP_MOUSE_BUTTON(3)
+#define KEYMAP_MOUSE_FORWARD  KEYMAP_MOUSE_BUTTON(4)
+
+typedef enum {
+  STICK_NONE = 0,
+  STICK_UP,
+  STICK_DOWN,
+  STICK_LEFT,
+  STICK_RIGHT,
+  STICK_WALK,     // held: left stick drops to the profile's walk tier
+} stick_action_t;
+
+// One word per entry so a lookup is a single load
+typedef struct {
+  uint8_t byte;   // byte of the 3-byte button block (byte 3 in the final report is 0)
+  uint8_t mask;   // bit(s) to set in that byte, 0 if unmapped
+  uint8_t stick;  // stick_action_t for left stick directions
+  uint8_t macro;  // 1 + macro program started by this input, 0 if none (macro.h)
+} keymap_entry_t;
+
+_Static_assert(sizeof(keymap_entry_t) == 4, "keymap_entry_t must stay one word");
+
+// Actions usable in a profile file
+#define KEYMAP_BUTTON(byte, bit)  { (byte), 1u << (bit), STICK_NONE, 0 }
+#define KEYMAP_STICK(dir)         { 0, 0, (dir), 0 }
+#define KEYMAP_MACRO(n)           { 0, 0, STICK_NONE, (n) + 1 }
+
+#define BUTTON_Y        KEYMAP_BUTTON(0, 0)
+#define BUTTON_X        KEYMAP_BUTTON(0, 1)
+#define BUTTON_B        KEYMAP_BUTTON(0, 2)
+#define BUTTON_A        KEYMAP_BUTTON(0, 3)
+#define BUTTON_R        KEYMAP_BUTTON(0, 6)
+#define BUTTON_ZR       KEYMAP_BUTTON(0, 7)
+#define BUTTON_MINUS    KEYMAP_BUTTON(1, 0)
+#define BUTTON_PLUS     KEYMAP_BUTTON(1, 1)
+#define BUTTON_RSTICK   KEYMAP_BUTTON(1, 2)
+#define BUTTON_LSTICK   KEYMAP_BUTTON(1, 3)
+#define BUTTON_HOME     KEYMAP_BUTTON(1, 4)
+#define BUTTON_CAPTURE  KEYMAP_BUTTON(1, 5)
+#define BUTTON_DOWN     KEYMAP_BUTTON(2, 0)
+#define BUTTON_UP       KEYMAP_BUTTON(2, 1)
+#define BUTTON_RIGHT    KEYMAP_BUTTON(2, 2)
+#define BUTTON_LEFT     KEYMAP_BUTTON(2, 3)
+#define BUTTON_L        KEYMAP_BUTTON(2, 6)
+#define BUTTON_ZL       KEYMAP_BUTTON(2, 7)
+
+#define LSTICK_UP       KEYMAP_STICK(STICK_UP)
+#define LSTICK_DOWN     KEYMAP_STICK(STICK_DOWN)
+#define LSTICK_LEFT     KEYMAP_STICK(STICK_LEFT)
+#define LSTICK_RIGHT    KEYMAP_STICK(STICK_RIGHT)
+#define LSTICK_WALK     KEYMAP_STICK(STICK_WALK)
+
+#define MACRO_1         KEYMAP_MACRO(0)
+#define MACRO_2         KEYMAP_MACRO(1)
+#define MACRO_3         KEYMAP_MACRO(2)
+#define MACRO_4         KEYMAP_MACRO(3)
+#define MACRO_5         KEYMAP_MACRO(4)
+#define MACRO_6         KEYMAP_MACRO(5)
+#define MACRO_7         KEYMAP_MACRO(6)
+#define MACRO_8         KEYMAP_MACRO(7)
+
+// Table used by the decoders, owned by profile.c
+extern keymap_entry_t const *keymap_active;
+
+static inline keymap_entry_t keymap_lookup(uint8_t usage)
+{
+  return keymap_active[usage];
+}
+
+#endif /* _KEYMAP_H_ */
@@ -0,0 +1,149 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "pico/platform.h"
+#include "pico/time.h"
+#include "log_ring.h"
+
+#define LOG_CORES  2
+
+// One ring per core: the owning core is the only producer, core0 the only
+// consumer, so neither side ever takes a lock (same scheme as hid_ring.h).
+typedef struct {
+  _Atomic uint32_t head;
+  _Atomic uint32_t tail;
+  _Atomic uint32_t dropped;   // written by the producer
+  uint32_t dropped_reported;  // read side copy
+  log_record_t records[LOG_RING_SIZE];
+} log_ring_t;
+
+static log_ring_t rings[LOG_CORES];
+
+static const char *const formats[LOG_ID_COUNT] = {
+#define LOG_MSG(name, format) [LOG_##name] = format,
+#include "log_messages.def"
+#undef LOG_MSG
+};
+
+static const char level_tags[] = "-EWID";
+
+void log_write(uint8_t level, uint8_t id, uint32_t const args[LOG_ARGS])
+{
+  uint8_t const core = get_core_num();
+  log_ring_t *ring = &rings[core];
+  uint32_t const head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t const tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  if (head - tail >= LOG_RING_SIZE) {
+    atomic_store_explicit(&ring->dropped, atomic_load_explicit(&ring->dropped, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    return;
+  }
+
+  log_record_t *record = &ring->records[head & (LOG_RING_SIZE - 1)];
+  record->time_us = time_us_32();
+  record->id = id;
+  record->level = level;
+  record->core = core;
+  for (uint8_t i = 0; i < LOG_ARGS; i++) record->args[i] = args[i];
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static log_record_t const *peek(log_ring_t *ring)
+{
+  uint32_t const tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint32_t const head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  if (head == tail) return NULL;
+  return &ring->records[tail & (LOG_RING_SIZE - 1)];
+}
+
+bool log_pop(log_record_t *record)
+{
+  // drops first, so they are reported close to where they happened
+  for (uint8_t core = 0; core < LOG_CORES; core++) {
+    log_ring_t *ring = &rings[core];
+    uint32_t const dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+    if (dropped != ring->dropped_reported) {
+      *record = (log_record_t) {
+        .time_us = time_us_32(),
+        .id = LOG_DROPPED,
+        .level = LOG_LEVEL_WARN,
+        .core = core,
+        .args = { dropped - ring->dropped_reported, core },
+      };
+      ring->dropped_reported = dropped;
+      return true;
+    }
+  }
+
+  // oldest of the two heads
+  log_ring_t *from = NULL;
+  log_record_t const *oldest = NULL;
+  for (uint8_t core = 0; core < LOG_CORES; core++) {
+    log_record_t const *next = peek(&rings[core]);
+    if (next && (oldest == NULL || (int32_t) (next->time_us - oldest->time_us) < 0)) {
+      from = &rings[core];
+      oldest = next;
+    }
+  }
+  if (oldest == NULL) return false;
+
+  *record = *oldest;
+  uint32_t const tail = atomic_load_explicit(&from->tail, memory_order_relaxed);
+  atomic_store_explicit(&from->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+bool log_pending(void)
+{
+  for (uint8_t core = 0; core < LOG_CORES; core++) {
+    log_ring_t *ring = &rings[core];
+    if (atomic_load_explicit(&ring->dropped, memory_order_relaxed) != ring->dropped_reported) return true;
+    if (peek(ring)) return true;
+  }
+  return false;
+}
+
+size_t log_format(log_record_t const *record, char *line, size_t size)
+{
+  char const *format = record->id < LOG_ID_COUNT ? formats[record->id] : "unknown message %lu";
+  unsigned long const a0 = record->id < LOG_ID_COUNT ? record->args[0] : record->id;
+  uint8_t const level = record->level < sizeof(level_tags) - 1 ? record->level : 0;
+
+  int n = snprintf(line, size, "%10lu %u%c ", (unsigned long) record->time_us, record->core, level_tags[level]);
+  if (n < 0 || (size_t) n >= size) return 0;
+  int m = snprintf(line + n, size - n, format, a0, (unsigned long) record->args[1],
+                   (unsigned long) record->args[2], (unsigned long) record->args[3]);
+  if (m < 0) return 0;
+  n += m;
+  // keep room for the line end even if the message was cut short
+  if ((size_t) n > size - 3) n = size - 3;
+  line[n++] = '\r';
+  line[n++] = '\n';
+  line[n] = '\0';
+  return n;
+}
@@ -0,0 +1,115 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _LOG_RING_H_
+#define _LOG_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Deferred binary logging.
+//
+// A log call stores a fixed-size record (time, message id, four arguments)
+// in a lock-free ring owned by the calling core and returns; nothing is
+// formatted and nothing waits on the UART. Core0 drains both rings when it
+// has nothing else to do and only then turns records into text with the
+// formats in log_messages.def. A full ring drops the record and counts it.
+//
+// Levels are resolved at compile time: call sites above LOG_LEVEL expand
+// to nothing, arguments included. Not for use from interrupt handlers.
+
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL  LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SIZE  64    // records per core
+#define LOG_ARGS       4
+#define LOG_LINE_MAX   96
+
+typedef enum {
+#define LOG_MSG(name, format) LOG_##name,
+#include "log_messages.def"
+#undef LOG_MSG
+  LOG_ID_COUNT
+} log_id_t;
+
+typedef struct {
+  uint32_t time_us;
+  uint8_t  id;      // log_id_t
+  uint8_t  level;
+  uint8_t  core;
+  uint8_t  reserved;
+  uint32_t args[LOG_ARGS];
+} log_record_t;
+
+_Static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+void log_write(uint8_t level, uint8_t id, uint32_t const args[LOG_ARGS]);
+
+// Missing arguments are zero
+#define LOG_WRITE(level, id, ...)  log_write(level, id, (uint32_t const[LOG_ARGS]) { __VA_ARGS__ })
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(id, ...)  LOG_WRITE(LOG_LEVEL_ERROR, LOG_##id, __VA_ARGS__)
+#else
+#define LOG_ERROR(id, ...)  ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(id, ...)   LOG_WRITE(LOG_LEVEL_WARN, LOG_##id, __VA_ARGS__)
+#else
+#define LOG_WARN(id, ...)   ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(id, ...)   LOG_WRITE(LOG_LEVEL_INFO, LOG_##id, __VA_ARGS__)
+#else
+#define LOG_INFO(id, ...)   ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(id, ...)  LOG_WRITE(LOG_LEVEL_DEBUG, LOG_##id, __VA_ARGS__)
+#else
+#define LOG_DEBUG(id, ...)  ((void) 0)
+#endif
+
+// Consumer side, core0 only: take the oldest record of either core.
+// A drop count shows up as a LOG_DROPPED record. Returns false when empty.
+bool log_pop(log_record_t *record);
+
+// True if log_pop() has something to return
+bool log_pending(void);
+
+// Render one record as a text line ending in "\r\n". Returns its length.
+size_t log_format(log_record_t const *record, char *line, size_t size);
+
+#endif /* _LOG_RING_H_ */
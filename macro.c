@@ -0,0 +1,171 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "pico/platform.h"
+#include "rate_profile.h"
+#include "macro.h"
+
+typedef struct {
+  bool    active;
+  uint8_t pc;
+  int32_t hold_us;    // time left before the next instruction; <= 0 once a
+                      // HOLD ran over, and taken off the next one
+  uint8_t wait;       // 0, or 1 + the edge being waited for
+  uint8_t loops;      // times the body has run, for MACRO_REPEAT(n)
+  uint8_t out[MACRO_OUTPUTS];
+} macro_run_t;
+
+static macro_bank_t const *macros = NULL;
+static macro_run_t runs[MACRO_MAX];
+static uint8_t last_triggers = 0;
+
+void macro_load(macro_bank_t const *bank)
+{
+  macros = bank;
+  memset(runs, 0, sizeof(runs));
+}
+
+bool macro_bank_valid(macro_bank_t const *bank)
+{
+  for (uint8_t i = 0; i < MACRO_MAX; i++) {
+    if (bank->start[i] != MACRO_NONE && bank->start[i] >= MACRO_CODE_SIZE) return false;
+  }
+  return true;
+}
+
+// Fetch the byte at pc, anything past the code area reads as MACRO_END
+static inline uint8_t fetch(macro_run_t *run)
+{
+  return run->pc < MACRO_CODE_SIZE ? macros->code[run->pc++] : MACRO_OP_END;
+}
+
+static void __not_in_flash_func(step)(macro_run_t *run, uint8_t start, uint32_t period_us,
+                                      bool held, bool pressed, bool released)
+{
+  if (run->hold_us > 0) {
+    run->hold_us -= (int32_t) period_us;
+    if (run->hold_us > 0) return;
+  }
+  if (run->wait) {
+    bool const edge = (run->wait == 1) ? released : pressed;
+    if (!edge) return;
+    run->wait = 0;
+  }
+
+  for (uint8_t steps = 0; steps < MACRO_STEPS; steps++) {
+    uint8_t const op = fetch(run);
+    switch (op)
+    {
+      case MACRO_OP_PRESS:
+      case MACRO_OP_RELEASE: {
+        uint8_t const index = fetch(run);
+        uint8_t const mask = fetch(run);
+        if (index >= MACRO_OUTPUTS) break;
+        if (op == MACRO_OP_PRESS) run->out[index] |= mask;
+        else run->out[index] &= ~mask;
+      }
+      break;
+
+      case MACRO_OP_HOLD:
+        run->hold_us += (int32_t) fetch(run) * RATE_TICK_US;
+        if (run->hold_us > 0) return;
+      break;
+
+      case MACRO_OP_REPEAT: {
+        uint8_t const count = fetch(run);
+        run->loops++;
+        if (count == 0 ? held : run->loops < count) {
+          run->pc = start;
+          break;
+        }
+        run->active = false;
+        return;
+      }
+
+      case MACRO_OP_WAIT:
+        // an edge starts the timing afresh
+        run->wait = 1 + (fetch(run) ? 1 : 0);
+        run->hold_us = 0;
+      return;
+
+      default:
+        run->active = false;
+      return;
+    }
+  }
+}
+
+void __not_in_flash_func(macro_frame)(uint8_t triggers, uint32_t period_us, uint8_t buttons[3], uint8_t *stick_dirs)
+{
+  if (macros == NULL) return;
+
+  uint8_t const pressed = triggers & ~last_triggers;
+  uint8_t const released = last_triggers & ~triggers;
+  last_triggers = triggers;
+
+  for (uint8_t i = 0; i < MACRO_MAX; i++) {
+    uint8_t const start = macros->start[i];
+    uint8_t const bit = 1u << i;
+    macro_run_t *run = &runs[i];
+    if (start == MACRO_NONE) continue;
+
+    if (!run->active) {
+      if (!(pressed & bit)) continue;
+      memset(run, 0, sizeof(*run));
+      run->active = true;
+      run->pc = start;
+      // the press that started it is not an edge to wait for
+      step(run, start, period_us, true, false, false);
+    }
+    else {
+      step(run, start, period_us, triggers & bit, pressed & bit, released & bit);
+    }
+
+    if (!run->active) {
+      memset(run->out, 0, sizeof(run->out));
+      continue;
+    }
+    buttons[0] |= run->out[0];
+    buttons[1] |= run->out[1];
+    buttons[2] |= run->out[2];
+    *stick_dirs |= run->out[3];
+  }
+}
+
+void __not_in_flash_func(macro_peek)(uint8_t buttons[3], uint8_t *stick_dirs)
+{
+  if (macros == NULL) return;
+
+  for (uint8_t i = 0; i < MACRO_MAX; i++) {
+    macro_run_t const *run = &runs[i];
+    if (!run->active) continue;
+    buttons[0] |= run->out[0];
+    buttons[1] |= run->out[1];
+    buttons[2] |= run->out[2];
+    *stick_dirs |= run->out[3];
+  }
+}
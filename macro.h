@@ -0,0 +1,112 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _MACRO_H_
+#define _MACRO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Turbo and scripted input, timed in ticks of RATE_TICK_US (30 ms).
+//
+// A profile carries up to MACRO_MAX short bytecode programs. A key bound to
+// KEYMAP_MACRO(n) starts program n when pressed; from then on macro_frame()
+// runs it once per 0x30 report, right after the held inputs are merged, and
+// ORs what it holds into that same report. Time only passes in HOLD and
+// WAIT, and only by the period each report stands for, so a program keeps
+// its timing whatever the loop was doing and whatever the rate profile.
+// At 30 ms reports a tick is exactly one report; at faster profiles a HOLD
+// ends on the first report at or past its time, and the overshoot is taken
+// off the next HOLD, so a loop keeps its average rate.
+//
+// Each program gets at most MACRO_STEPS instructions per report, which
+// bounds the work per frame even for a program that loops without holding.
+//
+// Instructions, one opcode byte followed by its operands:
+//   MACRO_PRESS(byte, mask)    set mask in output byte (0-2 buttons, 3 stick dirs)
+//   MACRO_RELEASE(byte, mask)  clear it again
+//   MACRO_HOLD(n)              keep the output for n ticks, the current report
+//                              included; the program goes on n ticks later
+//   MACRO_REPEAT(n)            jump back to the start: n = 0 while the trigger
+//                              is held, else until the body ran n times
+//   MACRO_WAIT_RELEASE         wait for the trigger to be released
+//   MACRO_WAIT_PRESS           wait for the trigger to be pressed again
+//   MACRO_END                  release everything and stop
+//
+// Turbo A while held, one press every 2 ticks, 16.7 a second on every rate
+// profile (rate_profile.h):
+//   MACRO_PRESS(0, 0x08), MACRO_HOLD(1), MACRO_RELEASE(0, 0x08), MACRO_HOLD(1), MACRO_REPEAT(0)
+
+#define MACRO_MAX        8
+#define MACRO_CODE_SIZE  88
+#define MACRO_STEPS      16
+#define MACRO_NONE       0xFF   // start of an unused program
+
+#define MACRO_OUTPUTS    4      // 3 button bytes + stick_dirs
+
+typedef enum {
+  MACRO_OP_END = 0,
+  MACRO_OP_PRESS,
+  MACRO_OP_RELEASE,
+  MACRO_OP_HOLD,
+  MACRO_OP_REPEAT,
+  MACRO_OP_WAIT,
+  MACRO_OP_COUNT
+} macro_op_t;
+
+#define MACRO_END                   MACRO_OP_END
+#define MACRO_PRESS(byte, mask)     MACRO_OP_PRESS, (byte), (mask)
+#define MACRO_RELEASE(byte, mask)   MACRO_OP_RELEASE, (byte), (mask)
+#define MACRO_HOLD(n)               MACRO_OP_HOLD, (n)
+#define MACRO_REPEAT(n)             MACRO_OP_REPEAT, (n)
+#define MACRO_WAIT_RELEASE          MACRO_OP_WAIT, 0
+#define MACRO_WAIT_PRESS            MACRO_OP_WAIT, 1
+
+typedef struct {
+  uint8_t start[MACRO_MAX];       // offset of each program in code, MACRO_NONE if unused
+  uint8_t code[MACRO_CODE_SIZE];
+} macro_bank_t;
+
+#define MACRO_BANK_EMPTY { .start = { MACRO_NONE, MACRO_NONE, MACRO_NONE, MACRO_NONE, \
+                                      MACRO_NONE, MACRO_NONE, MACRO_NONE, MACRO_NONE } }
+
+// Use the programs of a newly selected profile; anything running stops.
+void macro_load(macro_bank_t const *bank);
+
+// Check that every program starts inside the code area
+bool macro_bank_valid(macro_bank_t const *bank);
+
+// Run one report's worth of every program, period_us being the time that
+// report stands for. triggers has bit n set while an input bound to macro n
+// is held; the programs' held bits are ORed into the button block and the
+// stick directions.
+void macro_frame(uint8_t triggers, uint32_t period_us, uint8_t buttons[3], uint8_t *stick_dirs);
+
+// OR in what the running programs hold, without running them. For reports
+// built between two frames; a program pressed since then starts on the
+// next macro_frame().
+void macro_peek(uint8_t buttons[3], uint8_t *stick_dirs);
+
+#endif /* _MACRO_H_ */
@@ -0,0 +1,173 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/platform.h"
+#include "motion.h"
+
+typedef struct {
+  uint32_t time_us;
+  int32_t  dx;
+  int32_t  dy;
+} motion_sample_t;
+
+static motion_sample_t ring[MOTION_RING_SIZE];
+static uint16_t ring_tail = 0;
+static uint16_t ring_count = 0;
+
+static uint32_t last_us = 0;
+static bool started = false;
+
+static inline int32_t sat_add(int32_t a, int32_t b)
+{
+  int32_t r;
+  if (__builtin_add_overflow(a, b, &r)) r = (b > 0) ? INT32_MAX : INT32_MIN;
+  return r;
+}
+
+static inline int16_t sat_i16(int32_t v)
+{
+  if (v > INT16_MAX) return INT16_MAX;
+  if (v < INT16_MIN) return INT16_MIN;
+  return (int16_t) v;
+}
+
+static inline uint32_t magnitude(int32_t v)
+{
+  return v < 0 ? 0u - (uint32_t) v : (uint32_t) v;
+}
+
+// value * gain_q8 >> 8 (rounding down, as an arithmetic shift would),
+// saturated at +-MOTION_SAT, without a 64-bit multiply. Each gain range
+// clamps value where the product reaches MOTION_SAT << 8 anyway, so the
+// clamp never changes the result and m * g + 255 stays below 2^32.
+static inline int32_t __not_in_flash_func(mul_q8_sat)(int32_t value, int32_t gain_q8)
+{
+  uint32_t const g = magnitude(gain_q8);
+  uint32_t m = magnitude(value);
+  uint32_t const limit = g < (1u << 8) ? (1u << 24) : g < (1u << 16) ? (1u << 16) : g < (1u << 24) ? (1u << 8) : 1u;
+  if (m > limit) m = limit;
+
+  bool const negative = (value < 0) != (gain_q8 < 0);
+  uint32_t r = (m * g + (negative ? 255u : 0u)) >> 8;
+  if (r > MOTION_SAT) r = MOTION_SAT;
+  return negative ? -(int32_t) r : (int32_t) r;
+}
+
+void __not_in_flash_func(motion_add)(uint32_t time_us, int32_t dx, int32_t dy)
+{
+  if (ring_count == MOTION_RING_SIZE) {
+    // never drop motion: fold it into the newest sample instead
+    motion_sample_t *newest = &ring[(ring_tail + ring_count - 1) % MOTION_RING_SIZE];
+    newest->time_us = time_us;
+    newest->dx = sat_add(newest->dx, dx);
+    newest->dy = sat_add(newest->dy, dy);
+    return;
+  }
+  ring[(ring_tail + ring_count) % MOTION_RING_SIZE] = (motion_sample_t) { time_us, dx, dy };
+  ring_count++;
+}
+
+// counts per sub-interval -> gyro counts, with the acceleration curve applied
+static int16_t __not_in_flash_func(to_gyro)(int32_t counts, int32_t rate_q8, int32_t sens_q8, motion_config_t const *config)
+{
+  // The console integrates every sample over the nominal sub-interval, so
+  // the counts go out whole: a late frame carries all the motion since the
+  // last one and integrates to the same angle. Only the acceleration looks
+  // at the speed, normalised to the time the counts actually took.
+
+  // anything past 2^24 saturates below, the clamp only keeps * 3 in range
+  if (counts > (1 << 24)) counts = 1 << 24;
+  if (counts < -(1 << 24)) counts = -(1 << 24);
+  int32_t const counts_per_period = counts * MOTION_SUBSAMPLES;
+  uint32_t const speed = magnitude(mul_q8_sat(counts_per_period, rate_q8));
+
+  // speed <= MOTION_SAT and accel below 2^16 keep the product in 32 bits
+  uint32_t const accel = magnitude(config->accel_q8) > 0xFFFF ? 0xFFFF : magnitude(config->accel_q8);
+  int32_t extra = (int32_t) ((speed * accel) >> 8);
+  if (config->accel_q8 < 0) extra = -extra;
+  if (extra > config->accel_cap_q8) extra = config->accel_cap_q8;
+  return sat_i16(mul_q8_sat(counts_per_period, sat_add(sens_q8, extra)));
+}
+
+// Move everything up to now_us into MOTION_SUBSAMPLES bins and return the
+// Q8 factor that turns counts over the elapsed span into counts per
+// period_us, i.e. a speed
+static int32_t __not_in_flash_func(drain)(uint32_t now_us, uint32_t period_us,
+                                          int32_t bin_x[MOTION_SUBSAMPLES], int32_t bin_y[MOTION_SUBSAMPLES])
+{
+  uint32_t const start = started ? last_us : now_us - period_us;
+  uint32_t span = now_us - start;
+  if (span == 0) span = 1;
+  last_us = now_us;
+  started = true;
+
+  // sub-interval boundaries, relative to start
+  uint32_t const b1 = span / MOTION_SUBSAMPLES;
+  uint32_t const b2 = (span * 2) / MOTION_SUBSAMPLES;
+
+  for (uint8_t i = 0; i < MOTION_SUBSAMPLES; i++) bin_x[i] = bin_y[i] = 0;
+
+  while (ring_count) {
+    motion_sample_t const *s = &ring[ring_tail];
+    int32_t const offset = (int32_t) (s->time_us - start);
+    uint8_t const bin = offset < (int32_t) b1 ? 0 : offset < (int32_t) b2 ? 1 : 2;
+    bin_x[bin] = sat_add(bin_x[bin], s->dx);
+    bin_y[bin] = sat_add(bin_y[bin], s->dy);
+    ring_tail = (ring_tail + 1) % MOTION_RING_SIZE;
+    ring_count--;
+  }
+
+  // one 32-bit division per report, period_us < 2^23 keeps it in range
+  return (int32_t) ((period_us << 8) / span);
+}
+
+void __not_in_flash_func(motion_gyro_samples)(uint32_t now_us, uint32_t period_us, motion_config_t const *config,
+                                              int16_t gyro_x[MOTION_SUBSAMPLES], int16_t gyro_y[MOTION_SUBSAMPLES])
+{
+  int32_t bin_x[MOTION_SUBSAMPLES], bin_y[MOTION_SUBSAMPLES];
+  int32_t const rate_q8 = drain(now_us, period_us, bin_x, bin_y);
+
+  for (uint8_t i = 0; i < MOTION_SUBSAMPLES; i++) {
+    gyro_x[i] = to_gyro(bin_x[i], rate_q8, config->sens_x_q8, config);
+    gyro_y[i] = to_gyro(bin_y[i], rate_q8, config->sens_y_q8, config);
+  }
+}
+
+void __not_in_flash_func(motion_velocity)(uint32_t now_us, uint32_t period_us, int32_t *dx, int32_t *dy)
+{
+  int32_t bin_x[MOTION_SUBSAMPLES], bin_y[MOTION_SUBSAMPLES];
+  int32_t const rate_q8 = drain(now_us, period_us, bin_x, bin_y);
+
+  int32_t sum_x = 0, sum_y = 0;
+  for (uint8_t i = 0; i < MOTION_SUBSAMPLES; i++) {
+    sum_x = sat_add(sum_x, bin_x[i]);
+    sum_y = sat_add(sum_y, bin_y[i]);
+  }
+  *dx = mul_q8_sat(sum_x, rate_q8);
+  *dy = mul_q8_sat(sum_y, rate_q8);
+}
@@ -0,0 +1,68 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _MOTION_H_
+#define _MOTION_H_
+
+#include <stdint.h>
+
+// Mouse motion to gyro samples.
+//
+// Every mouse report is stored with its arrival time. When a 0x30 report is
+// built, the motion since the previous report is split into three equal
+// sub-intervals and each one becomes its own gyro sample, the way a real
+// controller reports three IMU samples per packet. All math is saturating
+// 32-bit integer / fixed point, so nothing here pulls in soft-float or the
+// 64-bit multiply and divide helpers.
+
+#define MOTION_RING_SIZE   256   // a full 30 ms frame of an 8 kHz mouse
+#define MOTION_SUBSAMPLES  3
+#define MOTION_SAT         65536  // speeds and velocities saturate here, counts per period
+
+typedef struct {
+  int32_t sens_x_q8;      // gyro counts per mouse count, Q24.8
+  int32_t sens_y_q8;
+  int32_t accel_q8;       // extra gain per count/frame of speed, Q24.8
+  int32_t accel_cap_q8;   // upper bound on the extra gain, Q24.8
+} motion_config_t;
+
+// Record one report's motion (x already inverted) at time_us
+void motion_add(uint32_t time_us, int32_t dx, int32_t dy);
+
+// Consume the motion up to now_us as MOTION_SUBSAMPLES gyro samples.
+// period_us is the nominal report period the console integrates over; all
+// the motion since the last report goes out, however long ago that was, so
+// the integrated angle follows the mouse even across a late frame. Only the
+// acceleration curve uses the speed over the time actually elapsed.
+void motion_gyro_samples(uint32_t now_us, uint32_t period_us, motion_config_t const *config,
+                         int16_t gyro_x[MOTION_SUBSAMPLES], int16_t gyro_y[MOTION_SUBSAMPLES]);
+
+// Consume the motion up to now_us as one velocity, in counts per period_us.
+// A velocity is held until the next report, so a late frame is normalised
+// to period_us rather than reported whole. It saturates at MOTION_SAT,
+// past the end of any mouse stick curve (mouse_stick.h).
+void motion_velocity(uint32_t now_us, uint32_t period_us, int32_t *dx, int32_t *dy);
+
+#endif /* _MOTION_H_ */
@@ -0,0 +1,188 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "pico/platform.h"
+#include "hid_items.h"
+#include "mouse_layout.h"
+
+#define USAGE_PAGE_DESKTOP  0x01
+#define USAGE_PAGE_BUTTON   0x09
+#define USAGE_X             0x30
+#define USAGE_Y             0x31
+#define USAGE_WHEEL         0x38
+
+#define MAX_REPORT_IDS      8
+#define MAX_USAGES          8
+
+void mouse_layout_boot(mouse_layout_t *layout)
+{
+  memset(layout, 0, sizeof(*layout));
+  layout->button_count = 8;
+  layout->button_offset = 0;
+  layout->x     = (mouse_field_t) { .bit_offset = 8,  .size = 8 };
+  layout->y     = (mouse_field_t) { .bit_offset = 16, .size = 8 };
+  layout->wheel = (mouse_field_t) { .bit_offset = 24, .size = 8 };
+}
+
+bool mouse_layout_parse(mouse_layout_t *layout, uint8_t const *desc, uint16_t desc_len)
+{
+  memset(layout, 0, sizeof(*layout));
+  if (desc == NULL) return false;
+
+  // running input bit offset for each report ID seen so far
+  struct { uint8_t id; uint16_t bits; } offsets[MAX_REPORT_IDS] = { { 0, 0 } };
+  uint8_t offset_count = 1;
+  uint8_t current = 0;
+  bool found_xy = false;
+  bool stop = false;
+
+  uint16_t usage_page = 0;
+  uint32_t report_size = 0;
+  uint32_t report_count = 0;
+  uint16_t usages[MAX_USAGES];
+  uint8_t usage_count = 0;
+  uint16_t usage_min = 0;
+  bool has_min = false;
+
+  // buttons are only valid if they share the X/Y report
+  struct { uint8_t id; uint16_t offset; uint8_t count; } buttons = { 0, 0, 0 };
+
+  uint16_t pos = 0;
+  hid_item_t item;
+  while (!stop && hid_item_next(desc, desc_len, &pos, &item)) {
+    if (item.type == HID_ITEM_TYPE_GLOBAL) {
+      switch (item.tag) {
+        case HID_GLOBAL_USAGE_PAGE:   usage_page = (uint16_t) item.data; break;
+        case HID_GLOBAL_REPORT_SIZE:  report_size = item.data; break;
+        case HID_GLOBAL_REPORT_COUNT: report_count = item.data; break;
+        case HID_GLOBAL_REPORT_ID: {
+          layout->uses_report_id = 1;
+          uint8_t i;
+          for (i = 0; i < offset_count; i++) {
+            if (offsets[i].id == (uint8_t) item.data) break;
+          }
+          if (i == offset_count) {
+            // no room to track this ID: stop here rather than add its
+            // fields to another report's offsets
+            if (offset_count == MAX_REPORT_IDS) { stop = true; break; }
+            offsets[offset_count].id = (uint8_t) item.data;
+            offsets[offset_count].bits = 0;
+            offset_count++;
+          }
+          current = i;
+        } break;
+        default: break;
+      }
+    }
+    else if (item.type == HID_ITEM_TYPE_LOCAL) {
+      switch (item.tag) {
+        case HID_LOCAL_USAGE:     if (usage_count < MAX_USAGES) usages[usage_count++] = item.data & 0xFFFF; break;
+        case HID_LOCAL_USAGE_MIN: usage_min = item.data & 0xFFFF; has_min = true; break;
+        default: break;
+      }
+    }
+    else if (item.type == HID_ITEM_TYPE_MAIN) {
+      if (item.tag == HID_MAIN_INPUT) {
+        uint16_t const start = offsets[current].bits;
+        uint8_t const id = offsets[current].id;
+        bool const constant = item.data & HID_INPUT_FLAG_CONSTANT;
+        bool const variable = item.data & HID_INPUT_FLAG_VARIABLE;
+
+        if (!constant && variable && usage_page == USAGE_PAGE_BUTTON && report_size == 1 && buttons.count == 0) {
+          buttons.id = id;
+          buttons.offset = start;
+          buttons.count = report_count > 8 ? 8 : (uint8_t) report_count;
+        }
+        else if (!constant && variable && usage_page == USAGE_PAGE_DESKTOP && report_size <= 32) {
+          for (uint32_t j = 0; j < report_count; j++) {
+            // one usage per element, the last one repeats; or a usage range
+            uint16_t usage = has_min ? (uint16_t) (usage_min + j)
+                           : usage_count ? usages[j < usage_count ? j : usage_count - 1u] : 0;
+            mouse_field_t field = { .bit_offset = (uint16_t) (start + j * report_size), .size = (uint8_t) report_size };
+
+            if (found_xy && id != layout->report_id) continue;
+            if      (usage == USAGE_X && layout->x.size == 0) layout->x = field;
+            else if (usage == USAGE_Y && layout->y.size == 0) layout->y = field;
+            else if (usage == USAGE_WHEEL && layout->wheel.size == 0) layout->wheel = field;
+
+            if (!found_xy && layout->x.size && layout->y.size) {
+              found_xy = true;
+              layout->report_id = id;
+            }
+          }
+        }
+        offsets[current].bits += (uint16_t) (report_size * report_count);
+      }
+      // locals only apply to the main item they precede
+      usage_count = 0;
+      has_min = false;
+    }
+  }
+
+  if (!found_xy) return false;
+  if (buttons.count && buttons.id == layout->report_id) {
+    layout->button_offset = buttons.offset;
+    layout->button_count = buttons.count;
+  }
+  return true;
+}
+
+// Read a little-endian, sign-extended field of size bits (<= 32)
+static int32_t __not_in_flash_func(read_signed)(uint8_t const *report, uint16_t len, uint16_t bit_offset, uint8_t size)
+{
+  if (size == 0 || ((bit_offset + size + 7) >> 3) > len) return 0;
+
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < size; i++) {
+    uint16_t bit = bit_offset + i;
+    value |= (uint32_t) ((report[bit >> 3] >> (bit & 7)) & 1) << i;
+  }
+  if (size < 32 && (value & (1u << (size - 1)))) value |= 0xFFFFFFFFu << size;
+  return (int32_t) value;
+}
+
+bool __not_in_flash_func(mouse_layout_decode)(mouse_layout_t const *layout, uint8_t const *report, uint16_t len,
+                                              uint8_t *buttons, int32_t *dx, int32_t *dy)
+{
+  if (layout->uses_report_id) {
+    if (len == 0 || report[0] != layout->report_id) return false;
+    report++;
+    len--;
+  }
+
+  uint8_t b = 0;
+  if (layout->button_count && ((layout->button_offset + layout->button_count + 7) >> 3) <= len) {
+    for (uint8_t i = 0; i < layout->button_count; i++) {
+      uint16_t bit = layout->button_offset + i;
+      b |= ((report[bit >> 3] >> (bit & 7)) & 1) << i;
+    }
+  }
+  *buttons = b;
+  *dx = read_signed(report, len, layout->x.bit_offset, layout->x.size);
+  *dy = read_signed(report, len, layout->y.bit_offset, layout->y.size);
+  return true;
+}
@@ -0,0 +1,69 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _MOUSE_LAYOUT_H_
+#define _MOUSE_LAYOUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Where a mouse puts its buttons and motion inside an input report.
+//
+// Boot mice send buttons + 8-bit X/Y, but in report protocol most gaming
+// mice prefix a report ID and send 12 or 16-bit deltas. mouse_layout_parse()
+// reads that from the report descriptor so high-resolution motion isn't
+// truncated.
+
+typedef struct {
+  uint16_t bit_offset;  // from the first byte after the report ID
+  uint8_t  size;        // in bits, 0 if the mouse doesn't have the axis
+  uint8_t  reserved;
+} mouse_field_t;
+
+typedef struct {
+  uint8_t  uses_report_id;
+  uint8_t  report_id;
+  uint8_t  button_count;
+  uint8_t  reserved;
+  uint16_t button_offset;
+  uint16_t reserved2;
+  mouse_field_t x;
+  mouse_field_t y;
+  mouse_field_t wheel;
+} mouse_layout_t;
+
+// Layout of the boot mouse report
+void mouse_layout_boot(mouse_layout_t *layout);
+
+// Find the buttons and X/Y/wheel fields in a report descriptor.
+// Returns false if there is no X/Y pair.
+bool mouse_layout_parse(mouse_layout_t *layout, uint8_t const *desc, uint16_t desc_len);
+
+// Extract buttons (bit n = button n+1) and motion from one report.
+// Returns false if the report isn't the mouse report.
+bool mouse_layout_decode(mouse_layout_t const *layout, uint8_t const *report, uint16_t len,
+                         uint8_t *buttons, int32_t *dx, int32_t *dy);
+
+#endif /* _MOUSE_LAYOUT_H_ */
@@ -0,0 +1,68 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdint.h>
+
+#include "pico/platform.h"
+#include "mouse_stick.h"
+
+static uint16_t curve_lut[MOUSE_STICK_LUT_SIZE];
+static uint32_t sens_q8 = 0;
+
+void mouse_stick_load(mouse_stick_config_t const *config)
+{
+  uint32_t const last = MOUSE_STICK_LUT_SIZE - 1;
+  uint32_t const deadzone = config->deadzone < MOUSE_STICK_RANGE ? config->deadzone : MOUSE_STICK_RANGE;
+  uint32_t const span = MOUSE_STICK_RANGE - deadzone;
+
+  // profile_bank_valid() already keeps banks in range, axis() relies on it
+  int32_t const sens = config->sens_q8;
+  sens_q8 = sens < 1 ? 1u : sens > MOUSE_STICK_SENS_MAX ? MOUSE_STICK_SENS_MAX : (uint32_t) sens;
+  curve_lut[0] = 0;
+  for (uint32_t i = 1; i < MOUSE_STICK_LUT_SIZE; i++) {
+    // blend of t and t^2 with t = i / last, all over last^2
+    uint32_t const shaped = i * last * (255u - config->curve) / 255u + i * i * config->curve / 255u;
+    curve_lut[i] = (uint16_t) (deadzone + span * shaped / (last * last));
+  }
+}
+
+static inline int32_t axis(int32_t counts)
+{
+  // at 0xFFFF counts even the lowest sensitivity reaches the end of the
+  // table, so clamping there first keeps the multiply in 32 bits
+  uint32_t magnitude = counts < 0 ? 0u - (uint32_t) counts : (uint32_t) counts;
+  if (magnitude > 0xFFFF) magnitude = 0xFFFF;
+  uint32_t index = (magnitude * sens_q8) >> 8;
+  if (index > MOUSE_STICK_LUT_SIZE - 1) index = MOUSE_STICK_LUT_SIZE - 1;
+  int32_t const deflection = curve_lut[index];
+  return counts < 0 ? -deflection : deflection;
+}
+
+void __not_in_flash_func(mouse_stick_axes)(int32_t dx, int32_t dy, int *horiz, int *vert)
+{
+  // x arrives inverted and mouse y grows downwards, so both flip here
+  *horiz = MOUSE_STICK_CENTER - axis(dx);
+  *vert = MOUSE_STICK_CENTER - axis(dy);
+}
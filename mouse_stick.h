@@ -0,0 +1,55 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _MOUSE_STICK_H_
+#define _MOUSE_STICK_H_
+
+#include <stdint.h>
+
+// Mouse velocity to right stick, for games without gyro aiming.
+//
+// The response curve is baked into a lookup table by mouse_stick_load()
+// whenever a profile becomes active, so a frame only costs a multiply, a
+// clamp and a table read per axis.
+
+#define MOUSE_STICK_LUT_SIZE  256
+#define MOUSE_STICK_CENTER    2047
+#define MOUSE_STICK_RANGE     2047   // full deflection either way, see to_joystick()
+#define MOUSE_STICK_SENS_MAX  0xFFFF // one count already reaches the end of the table
+
+typedef struct {
+  int32_t  sens_q8;     // LUT steps per mouse count per frame, Q24.8, 1..MOUSE_STICK_SENS_MAX
+  uint16_t deadzone;    // stick units added to any movement to clear the game's deadzone
+  uint8_t  curve;       // 0 = linear .. 255 = quadratic
+  uint8_t  reserved;
+} mouse_stick_config_t;
+
+// Precompute the response curve. Called when a profile is selected.
+void mouse_stick_load(mouse_stick_config_t const *config);
+
+// Per-frame velocity (x inverted, as stored by motion.h) to 12-bit stick axes
+void mouse_stick_axes(int32_t dx, int32_t dy, int *horiz, int *vert);
+
+#endif /* _MOUSE_STICK_H_ */
@@ -0,0 +1,25 @@
+# Portable input / protocol core of PicoPro.
+#
+# Shared by the firmware build (CMakeLists.txt) and the host build (host/),
+# so both always compile the same files. Nothing in here may call the Pico
+# SDK directly; the host build supplies thin shims for tusb.h and pico/*.h.
+
+set(PICOPRO_CORE_SOURCES
+  ${CMAKE_CURRENT_LIST_DIR}/report_queue.c
+  ${CMAKE_CURRENT_LIST_DIR}/profile.c
+  ${CMAKE_CURRENT_LIST_DIR}/kbd_layout.c
+  ${CMAKE_CURRENT_LIST_DIR}/mouse_layout.c
+  ${CMAKE_CURRENT_LIST_DIR}/motion.c
+  ${CMAKE_CURRENT_LIST_DIR}/mouse_stick.c
+  ${CMAKE_CURRENT_LIST_DIR}/socd.c
+  ${CMAKE_CURRENT_LIST_DIR}/macro.c
+  ${CMAKE_CURRENT_LIST_DIR}/spi_flash.c
+  ${CMAKE_CURRENT_LIST_DIR}/boot_metrics.c
+  ${CMAKE_CURRENT_LIST_DIR}/switch_proto.c
+  ${CMAKE_CURRENT_LIST_DIR}/pro_report.c
+  ${CMAKE_CURRENT_LIST_DIR}/input.c
+  ${CMAKE_CURRENT_LIST_DIR}/capture.c
+  ${CMAKE_CURRENT_LIST_DIR}/telemetry.c
+  ${CMAKE_CURRENT_LIST_DIR}/log_ring.c
+  ${CMAKE_CURRENT_LIST_DIR}/sched.c
+)
@@ -0,0 +1,142 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "pico/platform.h"
+#include "keymap.h"
+#include "input.h"
+#include "motion.h"
+#include "mouse_stick.h"
+#include "socd.h"
+#include "macro.h"
+#include "profile.h"
+#include "pro_report.h"
+
+// Byte offsets inside the 0x30 report
+#define REPORT_TIMER      1
+#define REPORT_BUTTONS    3
+#define REPORT_LSTICK     6
+#define REPORT_RSTICK     9
+#define REPORT_IMU        13
+#define IMU_SAMPLE_SIZE   12
+#define IMU_GYRO_Y        8   // within a sample
+#define IMU_GYRO_X        10
+
+// Everything that never changes: report ID, battery / connection info,
+// vibrator byte and the accelerometer fields, which stay zero.
+#define REPORT_TEMPLATE  { 0x30, 0x00, 0x81, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x22, 0xc8, 0x7b, 0x0c }
+
+// Two persistent reports, built into alternately. Only the newest one can be
+// waiting in the report queue, so the other is always free to patch.
+static uint8_t reports[2][PRO_REPORT_SIZE] __attribute__((aligned(4))) = { REPORT_TEMPLATE, REPORT_TEMPLATE };
+static uint8_t back = 0;
+
+// right stick resting position the firmware has always reported
+static const uint8_t right_joystick_rest[] = {0x22, 0xc8, 0x7b};
+
+// Convert joystick values ranging from 0 to 2047 (neutral) to 4095 (max, higher numbers will overflow)
+void __not_in_flash_func(to_joystick)(int horiz, int vert, uint8_t *data) {
+    uint8_t byte0 = horiz & 0x00FF; // mask out high byte to get low byte
+    uint8_t byte1nibblelow = (horiz >> 8) & 0x000F; // bitshift high byte to low byte and mask out all but lowest nibble
+    uint8_t byte1nibblehigh = (vert & 0x000F) << 4; // mask out all but lowest nibble and bitshift it to high nibble
+    uint8_t byte1 = byte1nibblelow | byte1nibblehigh; // bitwise or together middle nibbles
+    uint8_t byte2 = (vert >> 4) & 0x00FF; // bitshift all bytes by one nibble and mask out high byte to get low byte
+    data[0] = byte0;
+    data[1] = byte1;
+    data[2] = byte2;
+}
+
+// Little endian, the way the console reads every IMU field
+static inline void put_le16(uint8_t *p, int16_t value)
+{
+  p[0] = (uint16_t) value & 0xFF;
+  p[1] = (uint16_t) value >> 8;
+}
+
+// Timer, buttons and left stick; a frame steps macros by period_us and SOCD
+// ramps by one report, a refresh (period_us 0) steps nothing
+static uint8_t *__not_in_flash_func(build_buttons)(uint8_t timer, uint32_t period_us)
+{
+  uint8_t *report = reports[back];
+  back ^= 1;
+
+  // merge every keyboard and mouse into one controller state
+  input_state_t state;
+  input_aggregate(&state);
+  // macros land in the same report as the held inputs
+  if (period_us) macro_frame(state.macros, period_us, state.buttons, &state.stick_dirs);
+  else macro_peek(state.buttons, &state.stick_dirs);
+  report[REPORT_TIMER] = timer;
+  report[REPORT_BUTTONS] = state.buttons[0];
+  report[REPORT_BUTTONS + 1] = state.buttons[1];
+  report[REPORT_BUTTONS + 2] = state.buttons[2];
+
+  int horiz, vert;
+  if (period_us) socd_axes(state.stick_dirs, &horiz, &vert);
+  else socd_axes_peek(state.stick_dirs, &horiz, &vert);
+  to_joystick(horiz, vert, report + REPORT_LSTICK);
+  return report;
+}
+
+uint8_t const *__not_in_flash_func(pro_report_build)(uint8_t timer, uint32_t now_us, uint32_t period_us)
+{
+  uint8_t *report = build_buttons(timer, period_us);
+
+  // one gyro sample per third of the frame: mouse x drives yaw (gyro Z,
+  // bytes 10-11) and mouse y drives pitch (gyro Y, bytes 8-9)
+  int16_t gyro_x[MOTION_SUBSAMPLES] = { 0 }, gyro_y[MOTION_SUBSAMPLES] = { 0 };
+  if (profile_settings_active->mouse_mode == PROFILE_MOUSE_STICK) {
+    int32_t dx, dy;
+    int rhoriz, rvert;
+    motion_velocity(now_us, period_us, &dx, &dy);
+    mouse_stick_axes(dx, dy, &rhoriz, &rvert);
+    to_joystick(rhoriz, rvert, report + REPORT_RSTICK);
+  }
+  else {
+    motion_gyro_samples(now_us, period_us, &profile_settings_active->gyro, gyro_x, gyro_y);
+    memcpy(report + REPORT_RSTICK, right_joystick_rest, sizeof(right_joystick_rest));
+  }
+  uint8_t *imu = report + REPORT_IMU;
+  for (uint8_t i = 0; i < MOTION_SUBSAMPLES; i++, imu += IMU_SAMPLE_SIZE) {
+    put_le16(imu + IMU_GYRO_Y, gyro_y[i]);
+    put_le16(imu + IMU_GYRO_X, gyro_x[i]);
+  }
+  return report;
+}
+
+uint8_t const *__not_in_flash_func(pro_report_refresh)(uint8_t timer)
+{
+  uint8_t *report = build_buttons(timer, 0);
+
+  // the other buffer holds the last report
+  memcpy(report + REPORT_RSTICK, reports[back] + REPORT_RSTICK, 3);
+  uint8_t *imu = report + REPORT_IMU;
+  for (uint8_t i = 0; i < MOTION_SUBSAMPLES; i++, imu += IMU_SAMPLE_SIZE) {
+    put_le16(imu + IMU_GYRO_Y, 0);
+    put_le16(imu + IMU_GYRO_X, 0);
+  }
+  return report;
+}
@@ -0,0 +1,56 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _PRO_REPORT_H_
+#define _PRO_REPORT_H_
+
+#include <stdint.h>
+
+// Standard full input report (0x30): merges every host device into buttons,
+// sticks and three IMU samples. Portable, so it also builds on a host.
+
+#define PRO_REPORT_SIZE  64
+
+// Convert joystick values ranging from 0 to 2047 (neutral) to 4095 (max, higher numbers will overflow)
+void to_joystick(int horiz, int vert, uint8_t *data);
+
+// Build the 0x30 report for the state at now_us. period_us is the nominal
+// time between two reports.
+//
+// Reports are patched in place in one of two persistent buffers, so only
+// the timer, buttons, sticks and gyro bytes are written. The returned
+// report stays valid until the next call but one, long enough to sit in
+// the report queue until it is sent or replaced.
+uint8_t const *pro_report_build(uint8_t timer, uint32_t now_us, uint32_t period_us);
+
+// Build an extra report between two pro_report_build() frames, so a press
+// reaches the console without waiting for the next one. Buttons and the
+// left stick are current, but macros and SOCD ramps don't step and no
+// motion is drained: the console integrates gyro per report, so the IMU
+// samples are zero and the right stick repeats the last report. Turbo,
+// ramps and aim all stay timed by the regular frames.
+uint8_t const *pro_report_refresh(uint8_t timer);
+
+#endif /* _PRO_REPORT_H_ */
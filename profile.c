@@ -0,0 +1,213 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stddef.h>
+
+#include "tusb.h"
+#include "pico/platform.h"
+#include "profile.h"
+
+#define CHORD_MODIFIERS   ((1u << (HID_KEY_CONTROL_LEFT & 31)) | (1u << (HID_KEY_ALT_LEFT & 31)))
+#define CHORD_FIRST_KEY   HID_KEY_F1
+#define CHORD_KEY_COUNT   8
+
+//--------------------------------------------------------------------+
+// Built-in bank
+//--------------------------------------------------------------------+
+
+// Expand each profile file into a designated-initializer table: unmapped
+// usages stay zero, so lookups never need a "not found" path.
+#define KEYMAP_BIND(usage, action) [(usage)] = action,
+
+#define BUILTIN_PROFILE_COUNT 3
+
+static const struct {
+  profile_bank_header_t header;
+  profile_t profiles[BUILTIN_PROFILE_COUNT];
+} profile_builtin = {
+  .header = {
+    .magic = PROFILE_MAGIC,
+    .version = PROFILE_VERSION,
+    .count = BUILTIN_PROFILE_COUNT,
+    .tick_ms = PROFILE_TICK_MS,
+    .profile_size = sizeof(profile_t),
+  },
+  .profiles = {
+    {
+      .name = "default",
+      .settings = PROFILE_SETTINGS_GYRO,
+      .keymap = {
+#include "profiles/default.def"
+      },
+      .macros = MACRO_BANK_EMPTY,
+    },
+    {
+      .name = "arrows",
+      .settings = PROFILE_SETTINGS_GYRO,
+      .keymap = {
+#include "profiles/arrows.def"
+      },
+      .macros = MACRO_BANK_EMPTY,
+    },
+    {
+      // default bindings, mouse on the right stick for games without gyro
+      .name = "stick",
+      .settings = PROFILE_SETTINGS_STICK,
+      .keymap = {
+#include "profiles/default.def"
+      },
+      .macros = MACRO_BANK_EMPTY,
+    },
+  },
+};
+
+#undef KEYMAP_BIND
+
+_Static_assert(BUILTIN_PROFILE_COUNT <= PROFILE_MAX, "built-in profiles must fit in a flash bank");
+
+static profile_bank_t const *active_bank = (profile_bank_t const *) &profile_builtin;
+static profile_bank_t const *pending_bank = NULL;
+static uint8_t active_index = 0;
+
+// The active profile is copied to SRAM, so the keymap lookups, settings
+// and macro code of every report never wait on an XIP cache miss
+static profile_t active_profile;
+
+keymap_entry_t const *keymap_active = profile_builtin.profiles[0].keymap;
+profile_settings_t const *profile_settings_active = &profile_builtin.profiles[0].settings;
+
+//--------------------------------------------------------------------+
+// Bank handling
+//--------------------------------------------------------------------+
+
+uint32_t __not_in_flash_func(profile_crc32)(void const *data, uint32_t len)
+{
+  uint8_t const *p = data;
+  uint32_t crc = 0xFFFFFFFFu;
+  while (len--) {
+    crc ^= *p++;
+    for (uint8_t i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+  }
+  return ~crc;
+}
+
+bool profile_bank_valid(profile_bank_t const *bank, uint32_t len)
+{
+  if (len < sizeof(profile_bank_header_t)) return false;
+
+  profile_bank_header_t const *header = &bank->header;
+  if (header->magic != PROFILE_MAGIC || header->version != PROFILE_VERSION) return false;
+  if (header->profile_size != sizeof(profile_t)) return false;
+  if (header->count == 0 || header->count > PROFILE_MAX) return false;
+  // timings in any other unit would run at the wrong speed
+  if (header->tick_ms != 0 && header->tick_ms != PROFILE_TICK_MS) return false;
+
+  uint32_t body = (uint32_t) header->count * sizeof(profile_t);
+  if (len < sizeof(profile_bank_header_t) + body) return false;
+  if (profile_crc32(bank->profiles, body) != header->crc32) return false;
+
+  // every entry has to point inside the 3-byte button block, and every
+  // macro inside the code area
+  for (uint8_t p = 0; p < header->count; p++) {
+    if (!macro_bank_valid(&bank->profiles[p].macros)) return false;
+    if (bank->profiles[p].settings.mouse_mode > PROFILE_MOUSE_STICK) return false;
+    int32_t const sens = bank->profiles[p].settings.stick.sens_q8;
+    if (sens <= 0 || sens > MOUSE_STICK_SENS_MAX) return false;
+    if (bank->profiles[p].settings.socd.policy > SOCD_FIRST_WINS) return false;
+    if (bank->profiles[p].settings.socd.ramp_ticks > SOCD_RAMP_MAX) return false;
+    for (uint16_t k = 0; k < KEYMAP_SIZE; k++) {
+      keymap_entry_t const *entry = &bank->profiles[p].keymap[k];
+      if (entry->byte > 2 || entry->stick > STICK_WALK || entry->macro > MACRO_MAX) return false;
+    }
+  }
+  return true;
+}
+
+void profile_init(void const *flash_bank)
+{
+  profile_bank_t const *bank = flash_bank;
+  if (bank && profile_bank_valid(bank, PROFILE_FLASH_SIZE)) {
+    active_bank = bank;
+  }
+  else {
+    active_bank = (profile_bank_t const *) &profile_builtin;
+  }
+  profile_select(0);
+}
+
+bool profile_select(uint8_t index)
+{
+  if (index >= active_bank->header.count) return false;
+  active_index = index;
+  active_profile = active_bank->profiles[index];
+  keymap_active = active_profile.keymap;
+  profile_settings_active = &active_profile.settings;
+  mouse_stick_load(&profile_settings_active->stick);
+  socd_load(&profile_settings_active->socd);
+  macro_load(&active_profile.macros);
+  return true;
+}
+
+profile_bank_t const *profile_bank(void)
+{
+  return active_bank;
+}
+
+uint8_t profile_active_index(void)
+{
+  return active_index;
+}
+
+void profile_install(profile_bank_t const *bank)
+{
+  pending_bank = bank;
+}
+
+profile_bank_t const *profile_pending(void)
+{
+  return pending_bank;
+}
+
+void __not_in_flash_func(profile_apply_pending)(void)
+{
+  if (pending_bank == NULL) return;
+  active_bank = pending_bank;
+  pending_bank = NULL;
+  // keep the selected slot when the new bank still has it
+  if (!profile_select(active_index)) profile_select(0);
+}
+
+void __not_in_flash_func(profile_check_chord)(uint32_t const held[])
+{
+  if ((held[HID_KEY_CONTROL_LEFT >> 5] & CHORD_MODIFIERS) != CHORD_MODIFIERS) return;
+
+  for (uint8_t i = 0; i < CHORD_KEY_COUNT; i++) {
+    uint8_t usage = CHORD_FIRST_KEY + i;
+    if (held[usage >> 5] & (1u << (usage & 31))) {
+      if (i != active_index) profile_select(i);
+      return;
+    }
+  }
+}
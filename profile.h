@@ -0,0 +1,154 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "keymap.h"
+#include "motion.h"
+#include "mouse_stick.h"
+#include "socd.h"
+#include "macro.h"
+#include "rate_profile.h"
+
+// Mapping profiles.
+//
+// A profile bank is a header followed by fixed-size profiles, and is always
+// used in place: on the device it lives in flash and is read through XIP.
+// Switching profile copies just that profile to SRAM, so building a report
+// never reads flash.
+//
+// Two banks exist: the built-in one compiled from profiles/*.def, and an
+// optional one in the reserved sectors at the end of flash. The flash bank
+// wins when its header and CRC check out, so stations can carry their own
+// bindings without a rebuild.
+//
+// Holding Left Ctrl + Left Alt and pressing F1..F8 selects profile 1..8.
+//
+// A bank uploaded at runtime (see profile_upload.h) is staged with
+// profile_install() and swapped in by profile_apply_pending() at the start of
+// the next frame, so a report is never built from a half-written table.
+
+#define PROFILE_MAGIC       0x464F5250u   // "PROF"
+#define PROFILE_VERSION     4
+#define PROFILE_NAME_LEN    12
+
+// Unit of the SOCD ramp and macro HOLDs, the same on every rate profile.
+// Banks written before the header recorded it carry 0, which means this
+// same 30 ms: they were made for 30 ms reports.
+#define PROFILE_TICK_MS     (RATE_TICK_US / 1000)
+
+// Reserved flash at the very end of the chip, erased/programmed as a unit
+#define PROFILE_FLASH_SIZE  (2 * 4096u)
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint8_t  count;          // number of profiles that follow
+  uint8_t  tick_ms;        // PROFILE_TICK_MS, or 0 for a bank older than the field
+  uint32_t profile_size;   // sizeof(profile_t) the bank was built with
+  uint32_t crc32;          // over the profiles, checked for the flash bank
+} profile_bank_header_t;
+
+// What mouse motion drives
+typedef enum {
+  PROFILE_MOUSE_GYRO = 0,   // motion controls, right stick centred
+  PROFILE_MOUSE_STICK,      // right stick, gyro still
+} profile_mouse_mode_t;
+
+// Per-profile tuning that isn't a binding
+typedef struct {
+  uint8_t  mouse_mode;           // profile_mouse_mode_t
+  socd_config_t socd;            // opposite directions, ramp and walk tier of the left stick
+  motion_config_t gyro;          // mouse -> gyro sensitivity and acceleration
+  mouse_stick_config_t stick;    // mouse -> right stick response curve
+} profile_settings_t;
+
+// Gyro: 256 gyro counts per mouse count on X and 25.6 on Y, the gain the
+// firmware always had, no acceleration. Stick: full deflection at 64 counts
+// per frame, halfway between a linear and a quadratic curve. Left stick:
+// the last pressed direction wins, no ramp, walk at 3/8 deflection.
+#define PROFILE_SETTINGS_GYRO { \
+  .mouse_mode = PROFILE_MOUSE_GYRO, \
+  .socd = { .policy = SOCD_LAST_WINS, .ramp_ticks = 0, .walk = 96 }, \
+  .gyro = { .sens_x_q8 = 256 << 8, .sens_y_q8 = 6554, .accel_q8 = 0, .accel_cap_q8 = 0 }, \
+  .stick = { .sens_q8 = 4 << 8, .deadzone = 256, .curve = 128 }, \
+}
+
+#define PROFILE_SETTINGS_STICK { \
+  .mouse_mode = PROFILE_MOUSE_STICK, \
+  .socd = { .policy = SOCD_LAST_WINS, .ramp_ticks = 0, .walk = 96 }, \
+  .gyro = { .sens_x_q8 = 256 << 8, .sens_y_q8 = 6554, .accel_q8 = 0, .accel_cap_q8 = 0 }, \
+  .stick = { .sens_q8 = 4 << 8, .deadzone = 256, .curve = 128 }, \
+}
+
+typedef struct {
+  char name[PROFILE_NAME_LEN];
+  uint32_t reserved;
+  profile_settings_t settings;
+  keymap_entry_t keymap[KEYMAP_SIZE];
+  macro_bank_t macros;           // programs started by KEYMAP_MACRO() bindings
+} profile_t;
+
+typedef struct {
+  profile_bank_header_t header;
+  profile_t profiles[];
+} profile_bank_t;
+
+#define PROFILE_MAX  ((PROFILE_FLASH_SIZE - sizeof(profile_bank_header_t)) / sizeof(profile_t))
+
+// Pick the flash bank at flash_bank if it is valid, otherwise the built-in
+// bank, and activate its first profile.
+void profile_init(void const *flash_bank);
+
+// Validate a bank image of len bytes. Used for the flash bank and uploads.
+bool profile_bank_valid(profile_bank_t const *bank, uint32_t len);
+
+uint32_t profile_crc32(void const *data, uint32_t len);
+
+// Make profile index of the current bank active. Takes effect at the next
+// input_aggregate(), i.e. between two reports.
+bool profile_select(uint8_t index);
+
+profile_bank_t const *profile_bank(void);
+uint8_t profile_active_index(void);
+
+// Settings of the active profile, swapped together with keymap_active
+extern profile_settings_t const *profile_settings_active;
+
+// Stage an already validated bank; NULL cancels a staged bank.
+void profile_install(profile_bank_t const *bank);
+profile_bank_t const *profile_pending(void);
+
+// Swap in the staged bank, if any. Called between frames.
+void profile_apply_pending(void);
+
+// Check the held inputs for the profile switch chord
+void profile_check_chord(uint32_t const held[]);
+
+#endif /* _PROFILE_H_ */
@@ -0,0 +1,181 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "profile.h"
+#include "profile_upload.h"
+
+typedef enum {
+  RX_SYNC = 0,
+  RX_COMMAND,
+  RX_LEN_LO,
+  RX_LEN_HI,
+  RX_PAYLOAD,
+} rx_state_t;
+
+// Double-buffered so a new bank can be received while the last one is live
+static uint32_t shadow[2][PROFILE_FLASH_SIZE / sizeof(uint32_t)];
+
+static struct {
+  rx_state_t state;
+  uint8_t  command;
+  uint16_t len;
+  uint16_t received;
+  uint8_t *dest;
+  uint8_t  small[4];
+} rx;
+
+static bool is_shadow(profile_bank_t const *bank)
+{
+  return bank == (profile_bank_t const *) shadow[0] || bank == (profile_bank_t const *) shadow[1];
+}
+
+void profile_upload_reset(void)
+{
+  rx.state = RX_SYNC;
+}
+
+// Choose where the payload goes once the header is known
+static bool begin_payload(void)
+{
+  switch (rx.command)
+  {
+    case PROFILE_UPLOAD_BANK: {
+      if (rx.len < sizeof(profile_bank_header_t) || rx.len > PROFILE_FLASH_SIZE) return false;
+      uint32_t *buf = (profile_bank() == (profile_bank_t const *) shadow[0]) ? shadow[1] : shadow[0];
+      // the buffer may be staged but not swapped in yet
+      if (profile_pending() == (profile_bank_t const *) buf) profile_install(NULL);
+      memset(buf, 0xFF, sizeof(shadow[0]));
+      rx.dest = (uint8_t *) buf;
+    } return true;
+
+    case PROFILE_UPLOAD_SELECT:
+    case PROFILE_UPLOAD_SAVE:
+    case PROFILE_UPLOAD_INFO:
+      if (rx.len > sizeof(rx.small)) return false;
+      rx.dest = rx.small;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+static uint32_t finish_frame(uint8_t *reply)
+{
+  uint32_t n = 0;
+  uint8_t status = PROFILE_UPLOAD_OK;
+
+  switch (rx.command)
+  {
+    case PROFILE_UPLOAD_BANK: {
+      profile_bank_t const *bank = (profile_bank_t const *) rx.dest;
+      if (profile_bank_valid(bank, rx.len)) profile_install(bank);
+      else status = PROFILE_UPLOAD_BAD_BANK;
+    } break;
+
+    case PROFILE_UPLOAD_SELECT:
+      if (rx.len != 1 || !profile_select(rx.small[0])) status = PROFILE_UPLOAD_BAD_FRAME;
+    break;
+
+    case PROFILE_UPLOAD_SAVE: {
+      // only an uploaded bank is saved; the flash bank must not be rewritten
+      // while it is the one being read through XIP
+      profile_bank_t const *bank = profile_pending() ? profile_pending() : profile_bank();
+      if (!is_shadow(bank) || !profile_flash_save(bank, PROFILE_FLASH_SIZE)) status = PROFILE_UPLOAD_FAILED;
+    } break;
+
+    default: break;
+  }
+
+  reply[n++] = PROFILE_UPLOAD_SYNC;
+  reply[n++] = rx.command;
+  reply[n++] = status;
+  if (rx.command == PROFILE_UPLOAD_INFO) {
+    reply[n++] = profile_bank()->header.count;
+    reply[n++] = profile_active_index();
+  }
+  return n;
+}
+
+uint32_t profile_upload_feed(uint8_t const *data, uint32_t len, uint8_t *reply, uint32_t reply_max)
+{
+  uint32_t out = 0;
+
+  for (uint32_t i = 0; i < len; i++) {
+    uint8_t const byte = data[i];
+    bool done = false;
+
+    switch (rx.state)
+    {
+      case RX_SYNC:
+        if (byte == PROFILE_UPLOAD_SYNC) rx.state = RX_COMMAND;
+      break;
+
+      case RX_COMMAND:
+        rx.command = byte;
+        rx.state = RX_LEN_LO;
+      break;
+
+      case RX_LEN_LO:
+        rx.len = byte;
+        rx.state = RX_LEN_HI;
+      break;
+
+      case RX_LEN_HI:
+        rx.len |= (uint16_t) byte << 8;
+        rx.received = 0;
+        if (!begin_payload()) {
+          if (out + 3 <= reply_max) {
+            reply[out++] = PROFILE_UPLOAD_SYNC;
+            reply[out++] = rx.command;
+            reply[out++] = PROFILE_UPLOAD_BAD_FRAME;
+          }
+          rx.state = RX_SYNC;
+        }
+        else if (rx.len == 0) done = true;
+        else rx.state = RX_PAYLOAD;
+      break;
+
+      case RX_PAYLOAD: {
+        // copy as much of the payload as this chunk holds in one go
+        uint32_t chunk = rx.len - rx.received;
+        if (chunk > len - i) chunk = len - i;
+        memcpy(rx.dest + rx.received, data + i, chunk);
+        rx.received += chunk;
+        i += chunk - 1;
+        done = rx.received == rx.len;
+      } break;
+    }
+
+    if (done) {
+      if (out + PROFILE_UPLOAD_REPLY_MAX <= reply_max) out += finish_frame(reply + out);
+      else finish_frame((uint8_t[PROFILE_UPLOAD_REPLY_MAX]) { 0 });
+      rx.state = RX_SYNC;
+    }
+  }
+  return out;
+}
@@ -0,0 +1,71 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _PROFILE_UPLOAD_H_
+#define _PROFILE_UPLOAD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Live profile upload over the optional CDC port (PICOPRO_CDC_CONFIG).
+//
+// Frames are 'P', command, payload length (u16 little endian), payload.
+// Every frame is answered with 'P', command, status (+ command data).
+//
+//   0x01 BANK    payload: a complete profile bank image (profile.h)
+//   0x02 SELECT  payload: profile index
+//   0x03 SAVE    write the uploaded bank to the reserved flash sectors
+//   0x04 INFO    reply data: profile count, active index
+//
+// A bank is received into whichever of two RAM shadow buffers is not in
+// use, validated, then staged with profile_install(); the swap itself happens
+// between frames, so the 0x30 stream never sees a partial table.
+
+#define PROFILE_UPLOAD_SYNC     'P'
+
+#define PROFILE_UPLOAD_BANK     0x01
+#define PROFILE_UPLOAD_SELECT   0x02
+#define PROFILE_UPLOAD_SAVE     0x03
+#define PROFILE_UPLOAD_INFO     0x04
+
+#define PROFILE_UPLOAD_OK          0x00
+#define PROFILE_UPLOAD_BAD_FRAME   0x01
+#define PROFILE_UPLOAD_BAD_BANK    0x02
+#define PROFILE_UPLOAD_FAILED      0x03
+
+// Longest reply produced by profile_upload_feed() for one frame
+#define PROFILE_UPLOAD_REPLY_MAX   5
+
+// Drop any partially received frame (e.g. when the port is closed)
+void profile_upload_reset(void);
+
+// Feed received bytes. Replies for completed frames are written to reply
+// (at most reply_max bytes); returns the number of reply bytes.
+uint32_t profile_upload_feed(uint8_t const *data, uint32_t len, uint8_t *reply, uint32_t reply_max);
+
+// Provided by the platform: persist a bank image of PROFILE_FLASH_SIZE bytes
+bool profile_flash_save(void const *bank, uint32_t len);
+
+#endif /* _PROFILE_UPLOAD_H_ */
@@ -0,0 +1,34 @@
+# Lists the code that ends up in SRAM, i.e. every function placed with
+# __not_in_flash_func() plus whatever the SDK and PIO-USB put there.
+#
+# Run after each firmware build (CMakeLists.txt):
+#   cmake -DNM=<nm> -DELF=<PicoPro.elf> -DOUT=<PicoPro.ram.txt> -P ram_report.cmake
+#
+# The report has one "size name" line per function, largest first, and the
+# total is printed with the build output.
+
+execute_process(
+  COMMAND ${NM} --print-size --size-sort --reverse-sort ${ELF}
+  OUTPUT_VARIABLE symbols
+  RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "ram_report: ${NM} failed on ${ELF}")
+endif()
+
+# SRAM is 0x20000000..0x20041fff, text symbols only
+string(REPLACE "\n" ";" lines "${symbols}")
+set(report "")
+set(total 0)
+set(count 0)
+foreach(line IN LISTS lines)
+  if(line MATCHES "^20(0[0-3]|04[01])[0-9a-f]* ([0-9a-f]+) [tTwW] (.+)$")
+    math(EXPR size "0x${CMAKE_MATCH_2}")
+    math(EXPR total "${total} + ${size}")
+    math(EXPR count "${count} + 1")
+    string(APPEND report "${size} ${CMAKE_MATCH_3}\n")
+  endif()
+endforeach()
+
+file(WRITE ${OUT} "${report}")
+message(STATUS "ram_report: ${count} functions, ${total} bytes of code in SRAM, see ${OUT}")
@@ -0,0 +1,86 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _RATE_PROFILE_H_
+#define _RATE_PROFILE_H_
+
+// Output rate profiles, picked at build time with PICOPRO_RATE_PROFILE
+// (CMake cache variable of the same name).
+//
+// A profile fixes the HID endpoint polling interval, the 0x30 report period
+// matched to it, and the system clock, a multiple of 12 MHz so PIO-USB can
+// derive full-speed bit timing from it. Whether the console actually polls
+// that fast is measured, not assumed: the achieved report spacing is read
+// back over GET_REPORT (TELEMETRY_REPORT_RATE, telemetry.h).
+//
+//   profile   interval  report period  clk_sys
+//   30MS      8 ms      30 ms          120 MHz   original timing
+//   8MS       8 ms      8 ms           120 MHz
+//   4MS       4 ms      4 ms           120 MHz
+//   1MS       1 ms      1 ms           240 MHz   needs the slower flash boot2
+//
+// Profile timings, the SOCD ramp and macro HOLDs, count ticks of the
+// original 30 ms report period on every profile, so a bank keeps its
+// meaning at any rate: macro.c advances HOLDs by the time each report
+// stands for, and socd.c builds its ramp table for RATE_REPORT_PERIOD_US.
+
+#define RATE_TICK_US  30000
+
+#define RATE_PROFILE_30MS  0
+#define RATE_PROFILE_8MS   1
+#define RATE_PROFILE_4MS   2
+#define RATE_PROFILE_1MS   3
+
+#ifndef PICOPRO_RATE_PROFILE
+#define PICOPRO_RATE_PROFILE  RATE_PROFILE_30MS
+#endif
+
+#if PICOPRO_RATE_PROFILE == RATE_PROFILE_30MS
+#define RATE_HID_INTERVAL_MS   8
+#define RATE_REPORT_PERIOD_US  30000
+#define RATE_SYS_CLOCK_KHZ     120000
+#elif PICOPRO_RATE_PROFILE == RATE_PROFILE_8MS
+#define RATE_HID_INTERVAL_MS   8
+#define RATE_REPORT_PERIOD_US  8000
+#define RATE_SYS_CLOCK_KHZ     120000
+#elif PICOPRO_RATE_PROFILE == RATE_PROFILE_4MS
+#define RATE_HID_INTERVAL_MS   4
+#define RATE_REPORT_PERIOD_US  4000
+#define RATE_SYS_CLOCK_KHZ     120000
+#elif PICOPRO_RATE_PROFILE == RATE_PROFILE_1MS
+#define RATE_HID_INTERVAL_MS   1
+#define RATE_REPORT_PERIOD_US  1000
+#define RATE_SYS_CLOCK_KHZ     240000
+#else
+#error "unknown PICOPRO_RATE_PROFILE"
+#endif
+
+#if RATE_SYS_CLOCK_KHZ > 133000 && !defined(PICOPRO_SLOW_FLASH_BOOT2)
+#error "clk_sys above 133 MHz needs the slower flash boot2 (CMakeLists.txt)"
+#endif
+
+_Static_assert(RATE_SYS_CLOCK_KHZ % 12000 == 0, "PIO-USB needs a multiple of 12 MHz");
+
+#endif /* _RATE_PROFILE_H_ */
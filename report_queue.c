@@ -0,0 +1,130 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "tusb.h"
+#include "pico/platform.h"
+#include "pico/time.h"
+#include "report_queue.h"
+#include "boot_metrics.h"
+#include "rate_profile.h"
+#include "telemetry.h"
+
+#define SLOT_US  (RATE_HID_INTERVAL_MS * 1000u)
+
+report_queue_stats_t report_queue_stats;
+
+// Replies are only ever produced and consumed from tud_task() context on
+// core0, so plain indices are enough here.
+static uint8_t reply_fifo[REPORT_QUEUE_REPLY_SLOTS][REPORT_QUEUE_REPORT_SIZE];
+static uint32_t reply_queued_us[REPORT_QUEUE_REPLY_SLOTS];
+static uint8_t reply_head = 0;
+static uint8_t reply_count = 0;
+
+// points into pro_report's buffers, nothing is copied until tud_hid_report()
+static uint8_t const *input_report = NULL;
+static bool input_pending = false;
+
+// when the report that goes out next became next in line
+static uint32_t next_since_us;
+
+static inline bool __not_in_flash_func(queue_empty)(void)
+{
+  return reply_count == 0 && !input_pending;
+}
+
+bool __not_in_flash_func(report_queue_push_reply)(uint8_t const *report)
+{
+  if (reply_count == REPORT_QUEUE_REPLY_SLOTS) {
+    report_queue_stats.dropped_replies++;
+    return false;
+  }
+  uint8_t slot = (reply_head + reply_count) % REPORT_QUEUE_REPLY_SLOTS;
+  memcpy(reply_fifo[slot], report, REPORT_QUEUE_REPORT_SIZE);
+  reply_queued_us[slot] = time_us_32();
+  // a first reply goes ahead of a waiting input, which then starts over
+  if (reply_count == 0) next_since_us = reply_queued_us[slot];
+  reply_count++;
+  return true;
+}
+
+void __not_in_flash_func(report_queue_set_input)(uint8_t const *report)
+{
+  // a replacement inherits the wait of the one it replaces
+  if (input_pending) report_queue_stats.replaced_inputs++;
+  else if (reply_count == 0) next_since_us = time_us_32();
+  input_report = report;
+  input_pending = true;
+  telemetry_input_queued();
+}
+
+bool __not_in_flash_func(report_queue_input_pending)(void)
+{
+  return input_pending;
+}
+
+// Count the report about to go out if the endpoint kept it past a poll
+static void __not_in_flash_func(sent_next)(uint32_t now_us)
+{
+  if (now_us - next_since_us > SLOT_US) report_queue_stats.endpoint_busy++;
+  next_since_us = now_us;
+}
+
+void __not_in_flash_func(report_queue_kick)(void)
+{
+  if (queue_empty() || !tud_hid_ready()) return;
+
+  if (reply_count) {
+    if (tud_hid_report(0, reply_fifo[reply_head], REPORT_QUEUE_REPORT_SIZE)) {
+      uint32_t const now_us = time_us_32();
+      sent_next(now_us);
+      telemetry_histogram_add(&telemetry_reply_latency, now_us - reply_queued_us[reply_head]);
+      reply_head = (reply_head + 1) % REPORT_QUEUE_REPLY_SLOTS;
+      reply_count--;
+      report_queue_stats.sent_replies++;
+    }
+  }
+  else if (input_pending) {
+    if (tud_hid_report(0, input_report, REPORT_QUEUE_REPORT_SIZE)) {
+      uint32_t const now_us = time_us_32();
+      sent_next(now_us);
+      input_pending = false;
+      telemetry_input_sent(now_us);
+      if (report_queue_stats.sent_inputs++ == 0) boot_metrics_mark(BOOT_MARK_FIRST_INPUT);
+    }
+  }
+}
+
+// Invoked when sent REPORT successfully to host
+// Application can use this to send the next report
+void __not_in_flash_func(tud_hid_report_complete_cb)(uint8_t instance, uint8_t const* report, uint16_t len)
+{
+  (void) instance;
+  (void) report;
+  (void) len;
+
+  report_queue_kick();
+}
@@ -0,0 +1,74 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _REPORT_QUEUE_H_
+#define _REPORT_QUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Outbound report pipeline for the Pro Controller HID IN endpoint.
+//
+// Subcommand / USB command replies (0x21, 0x81) are queued FIFO and always go
+// out before input reports. Input reports (0x30) occupy a single slot that is
+// overwritten by newer state, so the console never receives a stale frame.
+// The endpoint is refilled from tud_hid_report_complete_cb(), so nothing is
+// handed to tud_hid_report() while a transfer is still in flight.
+//
+// Replies are stamped when queued, i.e. while the request that asked for
+// them is handled, and their latency goes to telemetry.h when they are sent.
+//
+// A report next in line normally waits at most one polling interval: the
+// transfer in flight completes on the next poll and it goes out then. One
+// that waited longer missed a poll because the endpoint was still busy, and
+// that is what endpoint_busy counts; waiting behind our own replies is not.
+
+#define REPORT_QUEUE_REPORT_SIZE  64
+#define REPORT_QUEUE_REPLY_SLOTS  4
+
+typedef struct {
+  uint32_t sent_replies;
+  uint32_t sent_inputs;
+  uint32_t dropped_replies;    // reply FIFO was full
+  uint32_t replaced_inputs;    // pending 0x30 overwritten before it was sent
+  uint32_t endpoint_busy;      // a report next in line waited more than one polling interval
+} report_queue_stats_t;
+
+extern report_queue_stats_t report_queue_stats;
+
+// Queue a 64-byte reply; returns false if the FIFO is full.
+bool report_queue_push_reply(uint8_t const *report);
+
+// Replace the pending input report with a newer one. The report is not
+// copied: it must stay as it is until it is sent or replaced.
+void report_queue_set_input(uint8_t const *report);
+
+// True while an input report is waiting for the endpoint.
+bool report_queue_input_pending(void);
+
+// Hand the next report to the endpoint if it is idle.
+void report_queue_kick(void);
+
+#endif /* _REPORT_QUEUE_H_ */
@@ -0,0 +1,103 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "pico/platform.h"
+#include "sched.h"
+
+sched_stats_t sched_stats[SCHED_MAX_TASKS];
+
+static sched_task_t const *tasks = NULL;
+static uint8_t task_count = 0;
+static uint8_t order[SCHED_MAX_TASKS];        // table indices, most urgent first
+static uint32_t deadlines[SCHED_MAX_TASKS];
+static uint32_t missed_total[SCHED_MAX_TASKS];  // sched_stats[].missed before it saturates
+
+void sched_init(sched_task_t const *table, uint8_t count, uint32_t now_us)
+{
+  if (count > SCHED_MAX_TASKS) count = SCHED_MAX_TASKS;
+  tasks = table;
+  task_count = count;
+  memset(sched_stats, 0, sizeof(sched_stats));
+  memset(missed_total, 0, sizeof(missed_total));
+
+  // insertion sort, stable so equal priorities keep their table order
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t j = i;
+    while (j && tasks[order[j - 1]].priority > tasks[i].priority) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+    deadlines[i] = now_us + tasks[i].period_us;
+  }
+}
+
+// Move a periodic task's deadline past now_us, staying on its grid
+static void __not_in_flash_func(advance)(uint8_t i, uint32_t now_us)
+{
+  uint32_t const period = tasks[i].period_us;
+  uint32_t const late = now_us - deadlines[i];
+  uint32_t const skipped = late / period;
+  sched_stats_t *stats = &sched_stats[i];
+
+  missed_total[i] += skipped;
+  stats->missed = missed_total[i] > UINT16_MAX ? UINT16_MAX : missed_total[i];
+  if (late > stats->max_late_us) stats->max_late_us = late > UINT16_MAX ? UINT16_MAX : late;
+  deadlines[i] += (skipped + 1) * period;
+}
+
+int8_t __not_in_flash_func(sched_run)(uint32_t now_us)
+{
+  for (uint8_t k = 0; k < task_count; k++) {
+    uint8_t const i = order[k];
+    sched_task_t const *task = &tasks[i];
+    bool const due = task->period_us && (int32_t) (now_us - deadlines[i]) >= 0;
+    if (!due && !(task->pending && task->pending())) continue;
+
+    if (due) advance(i, now_us);
+    task->run();
+    return (int8_t) i;
+  }
+  return -1;
+}
+
+uint32_t sched_next_deadline(uint32_t now_us)
+{
+  uint32_t until = 1000000;
+  for (uint8_t i = 0; i < task_count; i++) {
+    if (tasks[i].period_us == 0) continue;
+    int32_t const left = (int32_t) (deadlines[i] - now_us);
+    if (left <= 0) return now_us;
+    if ((uint32_t) left < until) until = (uint32_t) left;
+  }
+  return now_us + until;
+}
+
+uint32_t __not_in_flash_func(sched_missed)(uint8_t i)
+{
+  return i < SCHED_MAX_TASKS ? missed_total[i] : 0;
+}
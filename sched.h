@@ -0,0 +1,86 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _SCHED_H_
+#define _SCHED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Cooperative deadline scheduler for core0's loop.
+//
+// Tasks are registered once, as a table. A task is runnable when its period
+// comes round, when its pending() check says it has work, or both.
+// sched_run() runs the single most urgent runnable task and returns, so a
+// task never waits behind more than one task of lower priority. Periods run
+// on a fixed grid from sched_init(): a late run doesn't push the next
+// deadline back, and periods that went by entirely are counted as missed,
+// never run as a burst.
+//
+// Nothing in here reads the clock or sleeps. The caller passes the time in
+// and, when sched_run() finds nothing to do, may sleep until
+// sched_next_deadline() or until something raises an event.
+
+#define SCHED_MAX_TASKS  12
+
+typedef enum {
+  SCHED_PRIO_USB = 0,     // USB device servicing
+  SCHED_PRIO_REPORT,      // input decoding and report emission
+  SCHED_PRIO_TELEMETRY,
+  SCHED_PRIO_LOG,         // UART output
+} sched_priority_t;
+
+typedef struct {
+  void     (*run)(void);
+  bool     (*pending)(void);  // NULL: runs on its period only
+  uint32_t period_us;         // 0: runs when pending() only
+  uint8_t  priority;          // sched_priority_t; equal priorities go in table order
+} sched_task_t;
+
+typedef struct {
+  uint16_t missed;            // periods that went by without a run
+  uint16_t max_late_us;       // latest start after a deadline, saturates
+} sched_stats_t;
+
+// Per task, in table order; telemetry.h reads them back over GET_REPORT
+extern sched_stats_t sched_stats[SCHED_MAX_TASKS];
+
+// Periods task i has missed since sched_init(), without saturating.
+// sched_stats[i].missed is the same count held at UINT16_MAX so that the
+// whole table fits in one GET_REPORT.
+uint32_t sched_missed(uint8_t i);
+
+// Register the task table, which must stay valid. The first deadline of
+// every periodic task is one period after now_us.
+void sched_init(sched_task_t const *tasks, uint8_t count, uint32_t now_us);
+
+// Run the most urgent runnable task. Returns its index in the table, or -1
+// if nothing was runnable.
+int8_t sched_run(uint32_t now_us);
+
+// The earliest upcoming period deadline; now_us + 1 s if no task has one.
+uint32_t sched_next_deadline(uint32_t now_us);
+
+#endif /* _SCHED_H_ */
@@ -0,0 +1,132 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdbool.h>
+
+#include "pico/platform.h"
+#include "rate_profile.h"
+#include "keymap.h"
+#include "input.h"
+#include "mouse_stick.h"
+#include "socd.h"
+
+// Per axis: bit 0 is the negative direction, bit 1 the positive one
+#define AXIS_NEG   1u
+#define AXIS_POS   2u
+#define AXIS_BOTH  3u
+
+// Ramp length in reports, ticks converted at the build's report period
+#define RAMP_REPORTS_MAX  ((SOCD_RAMP_MAX * RATE_TICK_US + RATE_REPORT_PERIOD_US - 1) / RATE_REPORT_PERIOD_US)
+
+_Static_assert(RATE_TICK_US % 1000 == 0 && RATE_REPORT_PERIOD_US % 1000 == 0,
+               "the ramp table is built in whole milliseconds");
+
+typedef struct {
+  uint8_t held;      // bits held last frame
+  uint8_t winner;    // AXIS_NEG, AXIS_POS or 0
+  uint16_t reports;  // reports the winner has been unchanged, up to ramp_reports
+} axis_state_t;
+
+static uint16_t ramp_lut[RAMP_REPORTS_MAX + 1];
+static uint16_t ramp_reports;
+static socd_config_t config;
+static axis_state_t vert_axis, horiz_axis;
+
+void socd_load(socd_config_t const *new_config)
+{
+  config = *new_config;
+  if (config.ramp_ticks > SOCD_RAMP_MAX) config.ramp_ticks = SOCD_RAMP_MAX;
+
+  // Quadratic ease-in reaching full deflection ramp_ticks after the press,
+  // one entry per report. The report of the press shows one tick's worth,
+  // so at 30 ms reports report n of an r-tick ramp shows ((n + 1) / (r + 1))^2
+  // of full. In milliseconds everything stays below 2^32.
+  uint32_t const period_ms = RATE_REPORT_PERIOD_US / 1000;
+  uint32_t const tick_ms = RATE_TICK_US / 1000;
+  uint32_t const span_ms = (config.ramp_ticks + 1) * tick_ms;
+  ramp_reports = (uint16_t) ((config.ramp_ticks * tick_ms + period_ms - 1) / period_ms);
+  for (uint32_t i = 0; i <= RAMP_REPORTS_MAX; i++) {
+    uint32_t const t = i < ramp_reports ? i * period_ms + tick_ms : span_ms;
+    ramp_lut[i] = (uint16_t) (MOUSE_STICK_RANGE * t * t / (span_ms * span_ms));
+  }
+}
+
+// A peek (step false) resolves without stepping or remembering anything
+static int32_t __not_in_flash_func(resolve)(axis_state_t *axis, uint8_t held, bool step)
+{
+  uint8_t winner;
+  if (held != AXIS_BOTH) {
+    winner = held;
+  }
+  else if (config.policy == SOCD_LAST_WINS) {
+    // a single new press takes over, otherwise the last winner stays
+    uint8_t const pressed = held & ~axis->held;
+    winner = (pressed == AXIS_NEG || pressed == AXIS_POS) ? pressed : axis->winner;
+  }
+  else if (config.policy == SOCD_FIRST_WINS) {
+    winner = axis->winner;
+  }
+  else {
+    winner = 0;
+  }
+
+  uint16_t reports = axis->reports;
+  if (winner != axis->winner) reports = 0;
+  else if (reports < ramp_reports) reports++;
+  if (step) {
+    axis->reports = reports;
+    axis->held = held;
+    axis->winner = winner;
+  }
+
+  if (winner == 0) return 0;
+  int32_t const deflection = ramp_lut[reports];
+  return winner == AXIS_POS ? deflection : -deflection;
+}
+
+static void __not_in_flash_func(axes)(uint8_t stick_dirs, bool step, int *horiz, int *vert)
+{
+  uint8_t const v = ((stick_dirs >> STICK_DOWN) & 1) | (((stick_dirs >> STICK_UP) & 1) << 1);
+  uint8_t const h = ((stick_dirs >> STICK_LEFT) & 1) | (((stick_dirs >> STICK_RIGHT) & 1) << 1);
+  int32_t dv = resolve(&vert_axis, v, step);
+  int32_t dh = resolve(&horiz_axis, h, step);
+
+  if (config.walk && (stick_dirs & STICK_DIR_BIT(STICK_WALK))) {
+    dv = dv * config.walk / 256;
+    dh = dh * config.walk / 256;
+  }
+  *vert = MOUSE_STICK_CENTER + dv;
+  *horiz = MOUSE_STICK_CENTER + dh;
+}
+
+void __not_in_flash_func(socd_axes)(uint8_t stick_dirs, int *horiz, int *vert)
+{
+  axes(stick_dirs, true, horiz, vert);
+}
+
+void __not_in_flash_func(socd_axes_peek)(uint8_t stick_dirs, int *horiz, int *vert)
+{
+  axes(stick_dirs, false, horiz, vert);
+}
@@ -0,0 +1,68 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _SOCD_H_
+#define _SOCD_H_
+
+#include <stdint.h>
+
+// Digital directions to left stick.
+//
+// Each frame the held directions (input_state_t.stick_dirs) are resolved
+// per axis: when both directions of an axis are held, the profile's policy
+// picks one or neither. Only the held bits of the previous frame and the
+// previous winner are kept, so nothing accumulates and a missed release
+// can't leave the stick offset. The deflection optionally eases in over a
+// few ticks of RATE_TICK_US (30 ms, one report at the default rate; see
+// rate_profile.h) from a table socd_load() builds for the report period,
+// and a held STICK_WALK scales it down to the walk tier.
+
+#define SOCD_RAMP_MAX  16   // ticks
+
+typedef enum {
+  SOCD_NEUTRAL = 0,   // opposite directions cancel
+  SOCD_LAST_WINS,     // the direction pressed last wins
+  SOCD_FIRST_WINS,    // the direction held first keeps winning
+} socd_policy_t;
+
+typedef struct {
+  uint8_t policy;       // socd_policy_t
+  uint8_t ramp_ticks;   // ticks to full deflection, 0 = straight to full
+  uint8_t walk;         // walk deflection in 1/256 of full, 0 = no walk tier
+} socd_config_t;
+
+// Use a profile's settings. Called when a profile is selected.
+void socd_load(socd_config_t const *config);
+
+// Resolve one frame's held directions to 12-bit stick axes. Call exactly
+// once per report of RATE_REPORT_PERIOD_US, it advances the ramp one entry.
+void socd_axes(uint8_t stick_dirs, int *horiz, int *vert);
+
+// The axes for stick_dirs as they stand between two frames: the policy is
+// applied but no ramp advances and no press is remembered, so the next
+// socd_axes() frame sees the same edges.
+void socd_axes_peek(uint8_t stick_dirs, int *horiz, int *vert);
+
+#endif /* _SOCD_H_ */
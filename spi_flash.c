@@ -0,0 +1,97 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "pico/platform.h"
+#include "spi_flash.h"
+
+static uint16_t page_number[SPI_FLASH_MAX_PAGES];
+static uint8_t pages[SPI_FLASH_MAX_PAGES][SPI_FLASH_PAGE_SIZE];
+static uint8_t page_count = 0;
+
+void spi_flash_clear(void)
+{
+  page_count = 0;
+}
+
+static uint8_t *__not_in_flash_func(find_page)(uint16_t number)
+{
+  for (uint8_t i = 0; i < page_count; i++) {
+    if (page_number[i] == number) return pages[i];
+  }
+  return NULL;
+}
+
+static bool __not_in_flash_func(in_range)(uint32_t addr, uint16_t len)
+{
+  return addr < SPI_FLASH_SIZE && len <= SPI_FLASH_SIZE - addr;
+}
+
+bool __not_in_flash_func(spi_flash_write)(uint32_t addr, void const *data, uint16_t len)
+{
+  if (!in_range(addr, len)) return false;
+
+  uint8_t const *src = data;
+  while (len) {
+    uint16_t const number = addr / SPI_FLASH_PAGE_SIZE;
+    uint16_t const offset = addr % SPI_FLASH_PAGE_SIZE;
+    uint16_t const chunk = (len < SPI_FLASH_PAGE_SIZE - offset) ? len : SPI_FLASH_PAGE_SIZE - offset;
+
+    uint8_t *page = find_page(number);
+    if (page == NULL) {
+      if (page_count == SPI_FLASH_MAX_PAGES) return false;
+      page_number[page_count] = number;
+      page = pages[page_count++];
+      memset(page, 0xFF, SPI_FLASH_PAGE_SIZE);
+    }
+    memcpy(page + offset, src, chunk);
+
+    addr += chunk;
+    src += chunk;
+    len -= chunk;
+  }
+  return true;
+}
+
+bool __not_in_flash_func(spi_flash_read)(uint32_t addr, void *out, uint16_t len)
+{
+  if (!in_range(addr, len)) return false;
+
+  uint8_t *dst = out;
+  while (len) {
+    uint16_t const offset = addr % SPI_FLASH_PAGE_SIZE;
+    uint16_t const chunk = (len < SPI_FLASH_PAGE_SIZE - offset) ? len : SPI_FLASH_PAGE_SIZE - offset;
+
+    uint8_t const *page = find_page(addr / SPI_FLASH_PAGE_SIZE);
+    if (page) memcpy(dst, page + offset, chunk);
+    else memset(dst, 0xFF, chunk);
+
+    addr += chunk;
+    dst += chunk;
+    len -= chunk;
+  }
+  return true;
+}
@@ -0,0 +1,57 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _SPI_FLASH_H_
+#define _SPI_FLASH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Virtual image of the Pro Controller's 512 KB SPI flash.
+//
+// The console reads calibration, colours and the serial number with
+// subcommand 0x10 at arbitrary address/length. Only a few 256-byte pages
+// hold anything, so the image is sparse: populated pages live in RAM and
+// every other address reads back as erased flash (0xFF). Any read is then
+// answered from the image instead of a per-address table.
+
+#define SPI_FLASH_SIZE       0x80000u
+#define SPI_FLASH_PAGE_SIZE  256u
+#define SPI_FLASH_MAX_PAGES  4
+
+// Largest read/write the protocol carries in one subcommand
+#define SPI_FLASH_MAX_XFER   0x1D
+
+// Reset the image to erased flash
+void spi_flash_clear(void);
+
+// Store len bytes at addr, mapping pages as needed.
+// Returns false if the range is outside the chip or no page is left.
+bool spi_flash_write(uint32_t addr, void const *data, uint16_t len);
+
+// Copy len bytes at addr into out. Returns false if the range is outside the chip.
+bool spi_flash_read(uint32_t addr, void *out, uint16_t len);
+
+#endif /* _SPI_FLASH_H_ */
@@ -0,0 +1,238 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "tusb.h"
+#include "pico/platform.h"
+#include "report_queue.h"
+#include "spi_flash.h"
+#include "boot_metrics.h"
+#include "log_ring.h"
+#include "switch_proto.h"
+
+// Thanks to MIZUNO Yuki for these https://www.mzyy94.com/blog/2020/03/20/nintendo-switch-pro-controller-usb-gadget/
+#define EXTENDED_MAC_ADDR  0x00, 0x03, 0x00, 0x00, 0x5e, 0x00, 0x53, 0x5e
+#define INITIAL_INPUT      0x81, 0x00, 0x80, 0x00, 0xf8, 0xd7, 0x7a, 0x22, 0xc8, 0x7b, 0x0c
+#define INFO_FROM_DEVICE   0x03, 0x48, 0x03, 0x02, 0xe5, 0x35, 0x00, 0xe5, 0x00, 0x00, 0x03, 0x01
+#define NFC_IR             0x01, 0x00, 0xFF, 0x00, 0x03, 0x00, 0x05, 0x01
+
+static const uint8_t serial_number[] = { 0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
+static const uint8_t controller_color[] = { 0x29, 0xA9, 0xA9, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+static const uint8_t factory_sensor[] = { 0x50, 0xFD, 0x00, 0x00, 0xC6, 0x0F, 0x0F, 0x30, 0x61, 0x96, 0x30, 0xF3, 0xD4, 0x14, 0x54, 0x41, 0x15, 0x54, 0xC7, 0x79, 0x9C, 0x33, 0x36, 0x63 };
+static const uint8_t factory_stick[] = { 0x0F, 0x30, 0x61, 0x96, 0x30, 0xF3, 0xD4, 0x14, 0x54, 0x41, 0x15, 0x54, 0xC7, 0x79, 0x9C, 0x33, 0x36, 0x63 };
+static const uint8_t factory_config[] = { 0xBA, 0x15, 0x62, 0x11, 0xB8, 0x7F, 0x29, 0x06, 0x5B, 0xFF, 0xE7, 0x7E, 0x0E, 0x36, 0x56, 0x9E, 0x85, 0x60, 0xFF, 0x32, 0x32, 0x32, 0xFF, 0xFF, 0xFF };
+static const uint8_t user_stick[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xB2, 0xA1 };
+static const uint8_t user_motion[] = { 0xBE, 0xFF, 0x3E, 0x00, 0xF0, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x40, 0xFE, 0xFF, 0xFE, 0xFF, 0x08, 0x00, 0xE7, 0x3B, 0xE7, 0x3B, 0xE7, 0x3B };
+static const uint8_t initial_input[] = { INITIAL_INPUT };
+
+// Where each block lives in the controller's SPI flash. Later entries win
+// where blocks overlap: factory_config runs into the colour block at 0x6050.
+static const struct {
+  uint32_t addr;
+  uint8_t const *data;
+  uint16_t len;
+} spi_blocks[] = {
+  { 0x6000, serial_number,    sizeof(serial_number) },
+  { 0x603D, factory_config,   sizeof(factory_config) },
+  { 0x6050, controller_color, sizeof(controller_color) },
+  { 0x6080, factory_sensor,   sizeof(factory_sensor) },
+  { 0x6098, factory_stick,    sizeof(factory_stick) },
+  { 0x8010, user_stick,       sizeof(user_stick) },
+  { 0x8028, user_motion,      sizeof(user_motion) },
+};
+
+static bool input_enabled = false;
+static uint8_t reply_timer = 0;
+
+void switch_proto_init(void)
+{
+  spi_flash_clear();
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(spi_blocks); i++) {
+    spi_flash_write(spi_blocks[i].addr, spi_blocks[i].data, spi_blocks[i].len);
+  }
+  input_enabled = false;
+}
+
+bool __not_in_flash_func(switch_proto_input_enabled)(void)
+{
+  return input_enabled;
+}
+
+//--------------------------------------------------------------------+
+// Handshake replies
+//--------------------------------------------------------------------+
+
+// Every handshake reply is a complete report image built at compile time.
+// Static ones go out as they are; 0x21 replies only get the timer byte
+// patched in, and SPI replies fill their data into a copy of the image.
+// The images sit in SRAM with the dispatch code, so answering the console
+// never waits on an XIP miss.
+
+#define REPLY_SIZE  REPORT_QUEUE_REPORT_SIZE
+
+#define REPLY_IMAGE(name, ...)  static const uint8_t __not_in_flash("switch_proto") name[REPLY_SIZE] = { __VA_ARGS__ }
+
+// 0x21 subcommand reply: timer, input state, ack, subcommand id, data
+#define SUBCOMMAND_ACK(name, ack, id)         REPLY_IMAGE(name, 0x21, 0x00, INITIAL_INPUT, ack, id)
+#define SUBCOMMAND_REPLY(name, ack, id, ...)  REPLY_IMAGE(name, 0x21, 0x00, INITIAL_INPUT, ack, id, __VA_ARGS__)
+
+// Offset of the subcommand data in a 0x21 reply
+#define SUBCOMMAND_DATA  (2 + sizeof(initial_input) + 2)
+
+// 0x81 replies to the 0x80 USB commands
+REPLY_IMAGE(usb_reply_mac,       0x81, 0x01, EXTENDED_MAC_ADDR);
+REPLY_IMAGE(usb_reply_handshake, 0x81, 0x02);
+REPLY_IMAGE(usb_reply_baud,      0x81, 0x03);
+
+SUBCOMMAND_REPLY(reply_pairing,      0x81, 0x01, 0x03);             // Bluetooth manual pairing
+SUBCOMMAND_REPLY(reply_device_info,  0x82, 0x02, INFO_FROM_DEVICE);
+SUBCOMMAND_ACK(ack_input_mode,       0x80, 0x03);                   // set input report mode
+SUBCOMMAND_ACK(ack_trigger_time,     0x83, 0x04);                   // trigger buttons elapsed time
+SUBCOMMAND_ACK(ack_shipment,         0x80, 0x08);                   // set shipment low power state
+SUBCOMMAND_ACK(ack_spi_read,         0x90, 0x10);
+SUBCOMMAND_ACK(ack_spi_write,        0x80, 0x11);
+SUBCOMMAND_REPLY(reply_nfc_ir,       0xa0, 0x21, NFC_IR);           // NFC / IR MCU configuration
+SUBCOMMAND_ACK(ack_player_lights,    0x80, 0x30);                   // set player lights
+SUBCOMMAND_ACK(ack_home_light,       0x80, 0x38);                   // set HOME light
+SUBCOMMAND_ACK(ack_imu,              0x80, 0x40);                   // enable IMU
+SUBCOMMAND_ACK(ack_vibration,        0x80, 0x48);                   // enable vibration
+
+static void __not_in_flash_func(send_reply)(uint8_t const *image)
+{
+  report_queue_push_reply(image);
+  report_queue_kick();
+}
+
+// Queue a 0x21 reply, stamped with the current timer byte
+static void __not_in_flash_func(send_subcommand_reply)(uint8_t *report)
+{
+  report[1] = reply_timer;
+  send_reply(report);
+}
+
+//--------------------------------------------------------------------+
+// Subcommands (output report 0x01)
+//--------------------------------------------------------------------+
+
+// Builds the reply at runtime. args points at the subcommand arguments
+// (byte 11 of the output report).
+typedef void (*subcommand_handler_t)(uint8_t const *args, uint16_t len);
+
+typedef struct {
+  uint8_t const *reply;           // precomputed reply, or NULL
+  subcommand_handler_t handler;   // used when there is no precomputed reply
+} subcommand_t;
+
+// args: 32-bit little endian address, length. The reply echoes both.
+static void __not_in_flash_func(sub_spi_read)(uint8_t const *args, uint16_t len)
+{
+  if (len < 5) return;
+  uint32_t const addr = tu_u32(args[3], args[2], args[1], args[0]);
+  uint8_t const size = args[4] < SPI_FLASH_MAX_XFER ? args[4] : SPI_FLASH_MAX_XFER;
+
+  uint8_t report[REPLY_SIZE];
+  memcpy(report, ack_spi_read, REPLY_SIZE);
+  uint8_t *data = report + SUBCOMMAND_DATA;
+  memcpy(data, args, 4);
+  data[4] = size;
+  if (!spi_flash_read(addr, data + 5, size)) {
+    LOG_WARN(SPI_RANGE, addr);
+    return;
+  }
+  send_subcommand_reply(report);
+}
+
+// args: address, length, data. Acks with status 0 like the real controller.
+static void __not_in_flash_func(sub_spi_write)(uint8_t const *args, uint16_t len)
+{
+  if (len < 5 || args[4] > SPI_FLASH_MAX_XFER || len < 5 + args[4]) return;
+  uint32_t const addr = tu_u32(args[3], args[2], args[1], args[0]);
+
+  uint8_t report[REPLY_SIZE];
+  memcpy(report, ack_spi_write, REPLY_SIZE);
+  report[SUBCOMMAND_DATA] = spi_flash_write(addr, args + 5, args[4]) ? 0x00 : 0x01;
+  send_subcommand_reply(report);
+}
+
+// in SRAM with the reply images it points at and the SPI read path
+// (spi_flash.c), so a subcommand never waits on an XIP miss
+static const subcommand_t __not_in_flash("switch_proto") subcommands[256] = {
+  [0x01] = { reply_pairing },
+  [0x02] = { reply_device_info },
+  [0x03] = { ack_input_mode },
+  [0x04] = { ack_trigger_time },
+  [0x08] = { ack_shipment },
+  [0x10] = { NULL, sub_spi_read },
+  [0x11] = { NULL, sub_spi_write },
+  [0x21] = { reply_nfc_ir },
+  [0x30] = { ack_player_lights },
+  [0x38] = { ack_home_light },
+  [0x40] = { ack_imu },
+  [0x48] = { ack_vibration },
+};
+
+static void __not_in_flash_func(subcommand_dispatch)(uint8_t const *buffer, uint16_t bufsize)
+{
+  if (bufsize < 11) return;
+  subcommand_t const *sub = &subcommands[buffer[10]];
+  if (sub->reply) {
+    uint8_t report[REPLY_SIZE];
+    memcpy(report, sub->reply, REPLY_SIZE);
+    send_subcommand_reply(report);
+  }
+  else if (sub->handler) {
+    sub->handler(buffer + 11, bufsize - 11);
+  }
+  else {
+    LOG_WARN(SUBCMD_UNKNOWN, buffer[10]);
+  }
+}
+
+void __not_in_flash_func(switch_proto_output)(uint8_t const *buffer, uint16_t bufsize, uint8_t timer)
+{
+  if (bufsize < 2) return;
+  reply_timer = timer;
+
+  // Thanks to MIZUNO Yuki for this code https://www.mzyy94.com/blog/2020/03/20/nintendo-switch-pro-controller-usb-gadget/
+  if (buffer[0] == 0x80) {
+      if (buffer[1] == 0x01) {
+          send_reply(usb_reply_mac);
+      } 
+      else if (buffer[1] == 0x02) {
+          send_reply(usb_reply_handshake);
+      }
+      else if (buffer[1] == 0x03) {
+          send_reply(usb_reply_baud);
+      }
+      else if (buffer[1] == 0x04) {
+          input_enabled = true;
+          boot_metrics_mark(BOOT_MARK_HANDSHAKE);
+      }  
+  }
+  else if (buffer[0] == 0x01) {
+      subcommand_dispatch(buffer, bufsize);
+  }
+}
@@ -0,0 +1,62 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _SWITCH_PROTO_H_
+#define _SWITCH_PROTO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pro Controller side of the USB protocol: the 0x80 USB commands and the
+// 0x01 subcommands the console sends while pairing, answered into the
+// report queue. Nothing here touches the SDK, so it also builds on a host.
+
+// The timer byte of every input report and reply advances once per tick.
+// It is derived from the clock, so a stalled loop can't hold it back and
+// two reports always differ by the time between them.
+//
+// The tick is kept at 10 ms, the rate the firmware always had (3 every
+// 30 ms): what the console disliked was the old counter falling behind
+// whenever the loop stalled, not its rate, and there is no capture of a
+// real controller here to take a different rate from. If one shows a
+// different cadence, this is the only number to change; the console only
+// compares timer bytes with each other.
+#define SWITCH_PROTO_TIMER_TICK_US  10000
+
+static inline uint8_t switch_proto_timer(uint64_t now_us)
+{
+  return (uint8_t) (now_us / SWITCH_PROTO_TIMER_TICK_US);
+}
+
+// Build the SPI flash image. Call once before the console connects.
+void switch_proto_init(void);
+
+// Handle one output report from the console. timer is stamped on replies.
+void switch_proto_output(uint8_t const *buffer, uint16_t bufsize, uint8_t timer);
+
+// True once the console finished the handshake (0x80 0x04) and wants input
+bool switch_proto_input_enabled(void);
+
+#endif /* _SWITCH_PROTO_H_ */
@@ -0,0 +1,146 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "pico/platform.h"
+#include "pico/time.h"
+#include "task_timing.h"
+
+#if PICOPRO_TASK_TIMING
+
+#define SYSTICK_MASK  0x00FFFFFFu
+#define XIP_REBASE    0x80000000u  // clear the XIP counters past this count
+
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+  uint32_t xip_accesses;
+  uint32_t xip_misses;
+  uint32_t xip_skipped;
+  uint32_t buckets[TASK_TIMING_BUCKETS];
+} task_timing_t;
+
+static task_timing_t timings[TASK_TIMING_COUNT];
+static uint32_t loops[2];
+
+static const uint8_t task_cores[TASK_TIMING_COUNT] = {
+#define TASK_TIMING(name, core) [TASK_TIMING_##name] = core,
+#include "task_timing.def"
+#undef TASK_TIMING
+};
+
+void task_timing_init(void)
+{
+  // processor clock, no interrupt, count down from the full 24 bits
+  systick_hw->csr = 0;
+  systick_hw->rvr = SYSTICK_MASK;
+  systick_hw->cvr = 0;
+  systick_hw->csr = 0x5;
+
+  // saturating counters, start them from zero
+  if (get_core_num() == 0) {
+    xip_ctrl_hw->ctr_acc = 0;
+    xip_ctrl_hw->ctr_hit = 0;
+  }
+}
+
+void __not_in_flash_func(task_timing_add)(task_timing_id_t id, task_timing_start_t start)
+{
+  uint32_t const cycles = (start.cycles - systick_hw->cvr) & SYSTICK_MASK;
+  uint32_t const acc = xip_ctrl_hw->ctr_acc;
+  uint32_t const hit = xip_ctrl_hw->ctr_hit;
+  task_timing_t *t = &timings[id];
+  // cleared by core0 during the span, or stuck at the top
+  if (acc < start.xip_accesses || hit < start.xip_hits || acc == UINT32_MAX) {
+    t->xip_skipped++;
+  }
+  else {
+    uint32_t const accesses = acc - start.xip_accesses;
+    t->xip_accesses += accesses;
+    t->xip_misses += accesses - (hit - start.xip_hits);
+  }
+  if (t->count == 0 || cycles < t->min) t->min = cycles;
+  if (cycles > t->max) t->max = cycles;
+  t->count++;
+  t->total += cycles;
+  t->buckets[cycles ? 32 - __builtin_clz(cycles) : 0]++;
+}
+
+void __not_in_flash_func(task_timing_loop)(void)
+{
+  uint8_t const core = get_core_num();
+  loops[core]++;
+
+  // between two tasks of core0 nothing of its own is being measured; a
+  // core1 span across the clear sees its counts go down and skips them
+  if (core == 0 && xip_ctrl_hw->ctr_acc >= XIP_REBASE) {
+    xip_ctrl_hw->ctr_acc = 0;
+    xip_ctrl_hw->ctr_hit = 0;
+  }
+}
+
+static uint32_t p99(task_timing_t const *t)
+{
+  // samples allowed above the 99th percentile
+  uint32_t above = t->count / 100;
+  for (int8_t b = TASK_TIMING_BUCKETS - 1; b > 0; b--) {
+    if (t->buckets[b] > above) return (1u << b) - 1;
+    above -= t->buckets[b];
+  }
+  return 0;
+}
+
+uint16_t task_timing_get_report(uint8_t report_id, uint8_t *buffer, uint16_t reqlen)
+{
+  if (report_id == TASK_TIMING_REPORT_LOOPS) {
+    task_timing_loops_t const report = { { loops[0], loops[1] }, time_us_32() };
+    uint16_t const len = reqlen < sizeof(report) ? reqlen : sizeof(report);
+    memcpy(buffer, &report, len);
+    return len;
+  }
+
+  if (report_id < TASK_TIMING_REPORT_FIRST || report_id >= TASK_TIMING_REPORT_FIRST + TASK_TIMING_COUNT) return 0;
+  uint8_t const id = report_id - TASK_TIMING_REPORT_FIRST;
+  task_timing_t const *t = &timings[id];
+  task_timing_report_t const report = {
+    .count = t->count,
+    .min = t->min,
+    .avg = t->count ? (uint32_t) (t->total / t->count) : 0,
+    .max = t->max,
+    .p99 = p99(t),
+    .xip_accesses = t->xip_accesses,
+    .xip_misses = t->xip_misses,
+    .xip_skipped = t->xip_skipped,
+    .core = task_cores[id],
+  };
+  uint16_t const len = reqlen < sizeof(report) ? reqlen : sizeof(report);
+  memcpy(buffer, &report, len);
+  return len;
+}
+
+#endif
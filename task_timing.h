@@ -0,0 +1,131 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _TASK_TIMING_H_
+#define _TASK_TIMING_H_
+
+#include <stdint.h>
+
+// Cycle timing of every task in both cores' loops.
+//
+// Each core runs its own SysTick as a free-running 24-bit down-counter at
+// the system clock, and every task or callback in task_timing.def keeps
+// count, min, max, total and a log2 histogram of its cycles, from which
+// GET_REPORT works out the average and p99. Every slot is written only by
+// the core that runs the task, so nothing is locked; a read from the other
+// core can see a sample half-added, which is fine for statistics.
+//
+// Each task also adds up the XIP cache accesses and misses made while it
+// ran. The XIP counters are shared by both cores, so this includes
+// whatever the other core fetched meanwhile. With the hot path in SRAM
+// both should stay near zero for the report and callback tasks. The
+// hardware counters saturate at 2^32, so core0 clears them from its loop
+// once they pass half range; a sample whose span saw that clear, or a
+// saturated counter, adds nothing and is counted in xip_skipped instead.
+//
+// Built only with PICOPRO_TASK_TIMING (on by default in Debug builds);
+// otherwise every macro below is empty or just the call.
+//
+// Readout, vendor GET_REPORT IDs next to the telemetry ones (telemetry.h):
+//   TASK_TIMING_REPORT_LOOPS        task_timing_loops_t
+//   TASK_TIMING_REPORT_FIRST + id   task_timing_report_t of task id
+
+#define TASK_TIMING_REPORT_LOOPS  0xDF
+#define TASK_TIMING_REPORT_FIRST  0xE0
+#define TASK_TIMING_BUCKETS       25    // log2 of a 24-bit cycle count
+
+typedef enum {
+#define TASK_TIMING(name, core) TASK_TIMING_##name,
+#include "task_timing.def"
+#undef TASK_TIMING
+  TASK_TIMING_COUNT
+} task_timing_id_t;
+
+_Static_assert(TASK_TIMING_REPORT_FIRST + TASK_TIMING_COUNT <= 0xF0, "task timing IDs run into the telemetry reports");
+
+typedef struct {
+  uint32_t count;
+  uint32_t min;       // cycles
+  uint32_t avg;
+  uint32_t max;
+  uint32_t p99;       // upper edge of the log2 bucket holding the 99th percentile
+  uint32_t xip_accesses;
+  uint32_t xip_misses;
+  uint32_t xip_skipped;  // samples whose XIP counts were lost to a clear or saturation
+  uint8_t  core;
+  uint8_t  reserved[3];
+} task_timing_report_t;
+
+typedef struct {
+  uint32_t loops[2];  // main loop iterations per core since boot
+  uint32_t time_us;   // when they were read, for a rate between two reads
+} task_timing_loops_t;
+
+#if PICOPRO_TASK_TIMING
+
+#include "hardware/structs/systick.h"
+#include "hardware/structs/xip_ctrl.h"
+
+typedef struct {
+  uint32_t cycles;    // SysTick, counting down
+  uint32_t xip_accesses;
+  uint32_t xip_hits;
+} task_timing_start_t;
+
+static inline task_timing_start_t task_timing_now(void)
+{
+  return (task_timing_start_t) { systick_hw->cvr, xip_ctrl_hw->ctr_acc, xip_ctrl_hw->ctr_hit };
+}
+
+// Start this core's SysTick. Call once on each core before its loop.
+void task_timing_init(void);
+
+void task_timing_add(task_timing_id_t id, task_timing_start_t start);
+void task_timing_loop(void);
+
+// Fill a GET_REPORT for the IDs above; 0 for any other report ID.
+uint16_t task_timing_get_report(uint8_t report_id, uint8_t *buffer, uint16_t reqlen);
+
+#define TASK_TIMED(id, call)  do { \
+    task_timing_start_t const task_timing_start_ = task_timing_now(); \
+    call; \
+    task_timing_add(TASK_TIMING_##id, task_timing_start_); \
+  } while (0)
+
+// For a whole function body: BEGIN first, END before the return
+#define TASK_TIMING_BEGIN(id)  task_timing_start_t const task_timing_##id##_ = task_timing_now()
+#define TASK_TIMING_END(id)    task_timing_add(TASK_TIMING_##id, task_timing_##id##_)
+#define TASK_TIMING_LOOP()     task_timing_loop()
+
+#else
+
+#define TASK_TIMED(id, call)   call
+#define TASK_TIMING_BEGIN(id)  do { } while (0)
+#define TASK_TIMING_END(id)    do { } while (0)
+#define TASK_TIMING_LOOP()     do { } while (0)
+
+#endif
+
+#endif /* _TASK_TIMING_H_ */
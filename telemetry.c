@@ -0,0 +1,162 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "pico/platform.h"
+#include "pico/time.h"
+#include "report_queue.h"
+#include "sched.h"
+#include "rate_profile.h"
+#include "telemetry.h"
+
+_Static_assert(sizeof(telemetry_histogram_t) <= 63, "histogram must fit in one GET_REPORT");
+_Static_assert(sizeof(report_queue_stats_t) + sizeof(telemetry_counters_t) <= 63, "counters must fit in one GET_REPORT");
+_Static_assert(sizeof(sched_stats) <= 63, "scheduler stats must fit in one GET_REPORT");
+_Static_assert(sizeof(telemetry_rate_t) <= 63, "rate must fit in one GET_REPORT");
+
+telemetry_histogram_t telemetry_input_latency;
+telemetry_histogram_t telemetry_reply_latency;
+telemetry_counters_t telemetry_counters;
+telemetry_rate_t telemetry_rate = {
+  .profile = PICOPRO_RATE_PROFILE,
+  .hid_interval_ms = RATE_HID_INTERVAL_MS,
+  .report_period_us = RATE_REPORT_PERIOD_US,
+  .sys_clock_khz = RATE_SYS_CLOCK_KHZ,
+};
+
+// oldest edge not yet in a built report, and oldest edge in the queued one
+static bool edge_pending = false;
+static uint32_t edge_pending_us;
+static bool edge_queued = false;
+static uint32_t edge_queued_us;
+
+// achieved report spacing, see telemetry_rate_t; boot opens the first window
+static uint32_t last_sent_us = 0;
+static uint32_t window_start_us = 0;
+static uint32_t window_reports = 0;
+static uint32_t window_worst_us = 0;
+
+void __not_in_flash_func(telemetry_histogram_add)(telemetry_histogram_t *hist, uint32_t us)
+{
+  uint32_t bucket = 0;
+  if (us >> TELEMETRY_FIRST_SHIFT) {
+    bucket = 32 - TELEMETRY_FIRST_SHIFT - __builtin_clz(us);
+    if (bucket >= TELEMETRY_BUCKETS) bucket = TELEMETRY_BUCKETS - 1;
+  }
+  hist->buckets[bucket]++;
+  if (us > hist->max_us) hist->max_us = us;
+}
+
+void __not_in_flash_func(telemetry_input_edge)(uint32_t arrival_us)
+{
+  telemetry_counters.input_edges++;
+  if (!edge_pending) {
+    edge_pending = true;
+    edge_pending_us = arrival_us;
+  }
+}
+
+void __not_in_flash_func(telemetry_input_queued)(void)
+{
+  // a replaced frame never went out, its edges wait for this one
+  if (edge_pending && !edge_queued) {
+    edge_queued = true;
+    edge_queued_us = edge_pending_us;
+  }
+  edge_pending = false;
+}
+
+// Close the window once it has run its length. Called for every report sent
+// and every read, so a console that stopped polling reads back 0 and the
+// length of the silence instead of the last good numbers.
+static void __not_in_flash_func(rate_window)(uint32_t now_us)
+{
+  uint32_t const window = now_us - window_start_us;
+  if (window < TELEMETRY_RATE_WINDOW_US) return;
+
+  // nothing for a whole window length is no rate, however busy it was before
+  uint32_t const silence = now_us - last_sent_us;
+  bool const polled = window_reports && silence < TELEMETRY_RATE_WINDOW_US;
+  telemetry_rate.achieved_period_us = polled ? window / window_reports : 0;
+  telemetry_rate.worst_period_us = silence > window_worst_us ? silence : window_worst_us;
+  window_start_us = now_us;
+  window_reports = 0;
+  window_worst_us = 0;
+  // the next gap counts from here, the part before is in this window
+  last_sent_us = now_us;
+}
+
+static void __not_in_flash_func(rate_sent)(uint32_t now_us)
+{
+  uint32_t const gap = now_us - last_sent_us;
+  if (gap > window_worst_us) window_worst_us = gap;
+  window_reports++;
+  last_sent_us = now_us;
+  rate_window(now_us);
+}
+
+void __not_in_flash_func(telemetry_input_sent)(uint32_t now_us)
+{
+  rate_sent(now_us);
+  if (!edge_queued) return;
+  telemetry_histogram_add(&telemetry_input_latency, now_us - edge_queued_us);
+  edge_queued = false;
+}
+
+static uint16_t copy_out(uint8_t *buffer, uint16_t reqlen, void const *data, uint16_t len)
+{
+  if (len > reqlen) len = reqlen;
+  memcpy(buffer, data, len);
+  return len;
+}
+
+uint16_t telemetry_get_report(uint8_t report_id, uint8_t *buffer, uint16_t reqlen)
+{
+  switch (report_id)
+  {
+    case TELEMETRY_REPORT_COUNTERS: {
+      uint8_t payload[sizeof(report_queue_stats_t) + sizeof(telemetry_counters_t)];
+      memcpy(payload, &report_queue_stats, sizeof(report_queue_stats_t));
+      memcpy(payload + sizeof(report_queue_stats_t), &telemetry_counters, sizeof(telemetry_counters_t));
+      return copy_out(buffer, reqlen, payload, sizeof(payload));
+    }
+
+    case TELEMETRY_REPORT_INPUT_LATENCY:
+      return copy_out(buffer, reqlen, &telemetry_input_latency, sizeof(telemetry_input_latency));
+
+    case TELEMETRY_REPORT_REPLY_LATENCY:
+      return copy_out(buffer, reqlen, &telemetry_reply_latency, sizeof(telemetry_reply_latency));
+
+    case TELEMETRY_REPORT_SCHEDULE:
+      return copy_out(buffer, reqlen, sched_stats, sizeof(sched_stats));
+
+    case TELEMETRY_REPORT_RATE:
+      rate_window(time_us_32());
+      return copy_out(buffer, reqlen, &telemetry_rate, sizeof(telemetry_rate));
+
+    default: return 0;
+  }
+}
@@ -0,0 +1,106 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Nato Logic
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Latency histograms and drop counters, read back over GET_REPORT.
+//
+// An input edge (a host report that changed the held inputs or motion) is
+// timed from its arrival on core1 until the 0x30 report carrying it is
+// handed to tud_hid_report(). A reply is timed from the output report that
+// asked for it until it is handed to the endpoint. Both go into fixed log2
+// histograms, so recording is a count-leading-zeros and an increment.
+//
+// The vendor report IDs below aren't in the report descriptor, the console
+// never asks for them; a PC reads them with a GET_REPORT control request.
+// TinyUSB puts the ID in front of each payload, which leaves 63 bytes.
+
+#define TELEMETRY_REPORT_COUNTERS       0xF0  // report_queue_stats_t, then telemetry_counters_t
+#define TELEMETRY_REPORT_INPUT_LATENCY  0xF1  // telemetry_histogram_t
+#define TELEMETRY_REPORT_REPLY_LATENCY  0xF2  // telemetry_histogram_t
+#define TELEMETRY_REPORT_SCHEDULE       0xF3  // sched_stats_t per core0 task (sched.h)
+#define TELEMETRY_REPORT_RATE           0xF4  // telemetry_rate_t
+// 0xDF..0xEF are the per-task cycle timings of debug builds, see task_timing.h
+
+// Bucket 0 counts latencies below 128 us, bucket n >= 1 counts
+// [64 << n, 128 << n) us and the last one everything from 524 ms up.
+#define TELEMETRY_BUCKETS      14
+#define TELEMETRY_FIRST_SHIFT  7
+
+typedef struct {
+  uint32_t buckets[TELEMETRY_BUCKETS];
+  uint32_t max_us;
+} telemetry_histogram_t;
+
+typedef struct {
+  uint32_t input_edges;    // host reports that changed something
+  uint32_t late_frames;    // report ticks that ran a full period late
+  uint32_t ring_dropped;   // host reports core1 lost to a full hid_ring
+  uint32_t refreshes;      // extra reports sent for a press between two ticks
+} telemetry_counters_t;
+
+// The rate profile the firmware was built with (rate_profile.h) and the
+// spacing of the 0x30 reports the endpoint actually took, refreshes
+// included, over the last TELEMETRY_RATE_WINDOW_US. A read closes a window
+// that has run its length, so once nothing has gone out for a window length
+// achieved_period_us is 0 and worst_period_us the time since the last one.
+#define TELEMETRY_RATE_WINDOW_US  1000000
+
+typedef struct {
+  uint8_t  profile;             // RATE_PROFILE_*
+  uint8_t  hid_interval_ms;
+  uint16_t reserved;
+  uint32_t report_period_us;
+  uint32_t sys_clock_khz;
+  uint32_t achieved_period_us;  // mean time between two sent 0x30 reports, 0 if none
+  uint32_t worst_period_us;     // longest of those gaps, a silence included
+} telemetry_rate_t;
+
+extern telemetry_histogram_t telemetry_input_latency;
+extern telemetry_histogram_t telemetry_reply_latency;
+extern telemetry_counters_t telemetry_counters;
+extern telemetry_rate_t telemetry_rate;
+
+void telemetry_histogram_add(telemetry_histogram_t *hist, uint32_t us);
+
+// An input edge arrived at arrival_us and is now part of the held state
+void telemetry_input_edge(uint32_t arrival_us);
+
+// A 0x30 report was built from the current state and queued; it carries
+// every edge seen so far, including those of a frame it replaced.
+void telemetry_input_queued(void);
+
+// The queued 0x30 report was handed to the endpoint at now_us
+void telemetry_input_sent(uint32_t now_us);
+
+// Fill a GET_REPORT for one of the vendor report IDs.
+// Returns the payload length, 0 for any other report ID.
+uint16_t telemetry_get_report(uint8_t report_id, uint8_t *buffer, uint16_t reqlen);
+
+#endif /* _TELEMETRY_H_ */
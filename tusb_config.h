@@ -85,7 +85,13 @@
 #endif
 
 //------------- CLASS -------------//
+// Optional composite configuration with a CDC port for live profile upload.
+// Off by default: the console expects the plain Pro Controller interface.
+#ifdef PICOPRO_CDC_CONFIG
+#define CFG_TUD_CDC 1
+#else
 #define CFG_TUD_CDC 0
+#endif
 #define CFG_TUD_MSC 0
 #define CFG_TUD_HID 1
 #define CFG_TUD_MIDI 0
@@ -93,19 +99,21 @@
 // HID buffer size Should be sufficient to hold ID (if any) + Data
 #define CFG_TUD_HID_BUFSIZE 64
 
-// // CDC FIFO size of TX and RX
-// #define CFG_TUD_CDC_RX_BUFSIZE   256
-// #define CFG_TUD_CDC_TX_BUFSIZE   256
+// CDC FIFO size of TX and RX
+#define CFG_TUD_CDC_RX_BUFSIZE   256
+#define CFG_TUD_CDC_TX_BUFSIZE   256
 
-// // CDC Endpoint transfer buffer size, more is faster
-// #define CFG_TUD_CDC_EP_BUFSIZE   64
+// CDC Endpoint transfer buffer size, more is faster
+#define CFG_TUD_CDC_EP_BUFSIZE   64
 
 //--------------------------------------------------------------------
 // HOST CONFIGURATION
 //--------------------------------------------------------------------
 
 // Size of buffer to hold descriptors and other data used for enumeration
-#define CFG_TUH_ENUMERATION_BUFSIZE 256
+// Gaming (NKRO) keyboards ship report descriptors well over 256 bytes, which
+// would otherwise be skipped and leave tuh_hid_mount_cb() without a layout
+#define CFG_TUH_ENUMERATION_BUFSIZE 512
 
 #define CFG_TUH_HUB                 1
 // max device support (excluding hub device)